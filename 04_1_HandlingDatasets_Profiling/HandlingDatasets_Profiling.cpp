@@ -0,0 +1,294 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include "SIMCAQP.h"
+#include "../Common/QuantileSketch.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// STATISTICS OF ONE VARIABLE
+//////////////////////////////////////////////////////////////////////////
+
+struct VariableProfile
+{
+  std::string name;
+  size_t count = 0;   // values that are not missing
+  size_t missing = 0;
+  double mean = 0;
+  double sumSquares = 0; // sum of squared deviations from the mean
+  float fMin = std::numeric_limits<float>::infinity();
+  float fMax = -std::numeric_limits<float>::infinity();
+  QuantileSketch sketch;
+
+  // Adds the values of one chunk. The chunk's count, sum, minimum and
+  // maximum are computed in one loop without branches: missing values are
+  // masked out with selects instead of skipped. A second loop adds up the
+  // squared deviations from the chunk's mean, which is then merged into the
+  // running mean and sum of squares (Chan et al.), so the result does not
+  // depend on how the observations are split into chunks. The quantile
+  // sketch gets its values in a last loop. The buffer holds one variable of
+  // one chunk, so the later loops read it from the cache.
+  void AddChunk(const float* pValues, size_t numValues, float fMissingValue)
+  {
+    const float fInfinity = std::numeric_limits<float>::infinity();
+    size_t chunkCount = 0;
+    double chunkSum = 0;
+    float fChunkMin = fInfinity, fChunkMax = -fInfinity;
+    for(size_t i = 0; i < numValues; i++){
+      float x = pValues[i];
+      bool bPresent = (x == x) & (x != fMissingValue); // x == x is false for NaN
+      chunkCount += bPresent;
+      chunkSum += bPresent ? x : 0.0f;
+      fChunkMin = std::min(fChunkMin, bPresent ? x : fInfinity);
+      fChunkMax = std::max(fChunkMax, bPresent ? x : -fInfinity);
+    }
+    missing += numValues - chunkCount;
+    if(chunkCount == 0)
+      return;
+
+    double chunkMean = chunkSum / double(chunkCount);
+    double chunkSumSquares = 0;
+    for(size_t i = 0; i < numValues; i++){
+      float x = pValues[i];
+      bool bPresent = (x == x) & (x != fMissingValue);
+      double deviation = bPresent ? x - chunkMean : 0.0;
+      chunkSumSquares += deviation * deviation;
+    }
+
+    for(size_t i = 0; i < numValues; i++){
+      float x = pValues[i];
+      if(x == x && x != fMissingValue)
+	sketch.Add(x);
+    }
+
+    fMin = std::min(fMin, fChunkMin);
+    fMax = std::max(fMax, fChunkMax);
+    double delta = chunkMean - mean;
+    size_t total = count + chunkCount;
+    mean += delta * double(chunkCount) / double(total);
+    sumSquares += chunkSumSquares + delta * delta * double(count) * double(chunkCount) / double(total);
+    count = total;
+  }
+
+  double StdDev() const { return count > 1 ? std::sqrt(sumSquares / double(count - 1)) : NAN; }
+};
+
+struct DatasetProfile
+{
+  std::string name;
+  int numObservations = 0;
+  std::vector<VariableProfile> variables;
+  std::string error;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// PROFILE ONE DATASET IN CHUNKS
+//////////////////////////////////////////////////////////////////////////
+
+// Reads the observations of the dataset chunkSize at a time, selected with a
+// SQ_IntVector, so that only one chunk is held in memory. The values of one
+// variable are copied out of the chunk into a buffer before the statistics
+// are updated.
+void ProfileDataset(SQ_Project hProject, int iDatasetIndex, int chunkSize, float fMissingValue,
+		    DatasetProfile& profile)
+{
+  char szBuffer[256];
+
+  int iDatasetNumber;
+  SQ_Dataset hDataset = NULL;
+  SQ_GetDatasetNumberFromIndex(hProject, iDatasetIndex, &iDatasetNumber);
+  if(SQ_GetDataset(hProject, iDatasetNumber, &hDataset) != SQ_E_OK)
+    {
+      profile.error = "could not load dataset";
+      return;
+    }
+  SQ_GetDataSetName(hDataset, szBuffer, sizeof(szBuffer));
+  profile.name = szBuffer;
+
+  SQ_VariableVector hVariables = NULL;
+  int numVariables;
+  SQ_GetDataSetVariableNames(hDataset, &hVariables);
+  SQ_GetNumVariablesInVector(hVariables, &numVariables);
+  profile.variables.resize(size_t(numVariables));
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numVariables;iVar++){
+    SQ_GetVariableFromVector(hVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    profile.variables[iVar - 1].name = szBuffer;
+  }
+  SQ_ClearVariableVector(&hVariables);
+
+  SQ_StringVector hObservationNames = NULL;
+  SQ_GetDataSetObservationNames(hDataset, 1, &hObservationNames);
+  SQ_GetNumStringsInVector(hObservationNames, &profile.numObservations);
+  SQ_ClearStringVector(&hObservationNames);
+
+  std::vector<float> buffer;
+  for(int iFirst=1;iFirst<=profile.numObservations;iFirst+=chunkSize){
+    int numInChunk = std::min(chunkSize, profile.numObservations - iFirst + 1);
+    SQ_IntVector hObservations = NULL;
+    SQ_InitIntVector(&hObservations, numInChunk);
+    for(int i=0;i<numInChunk;i++)
+      SQ_SetDataInIntVector(hObservations, i + 1, iFirst + i);
+
+    SQ_VectorData hChunk = NULL;
+    SQ_ErrorCode eError = SQ_GetDataSetObservations(hDataset, &hObservations, &hChunk);
+    SQ_ClearIntVector(&hObservations);
+    if(eError != SQ_E_OK)
+      {
+	SQ_GetErrorDescription(eError, szBuffer, sizeof(szBuffer));
+	profile.error = szBuffer;
+	return;
+      }
+
+    // Rows are variables and columns are observations
+    SQ_FloatMatrix hMatrix = NULL;
+    SQ_GetDataMatrix(hChunk, &hMatrix);
+    buffer.resize(size_t(numInChunk));
+    for(int iVar=1;iVar<=numVariables;iVar++){
+      for(int iObs=1;iObs<=numInChunk;iObs++)
+	SQ_GetDataFromFloatMatrix(hMatrix, iVar, iObs, &buffer[size_t(iObs - 1)]);
+      profile.variables[iVar - 1].AddChunk(buffer.data(), buffer.size(), fMissingValue);
+    }
+    SQ_ClearFloatMatrix(&hMatrix);
+    SQ_ClearVectorData(&hChunk);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// WORKER: DATASETS ON ITS OWN PROJECT COPY
+//////////////////////////////////////////////////////////////////////////
+
+// Takes the next dataset from the shared counter and only writes to the
+// profiles of the datasets it took
+void ProfileDatasetsOnCopy(const char* szUSPFile, int chunkSize, float fMissingValue,
+			   std::atomic<int>& nextDataset, std::vector<DatasetProfile>& profiles)
+{
+  SQ_Project hProject = NULL;
+  if(SQ_OpenProject(szUSPFile, NULL, &hProject) != SQ_E_OK)
+    return;
+
+  for(int i = nextDataset++; i < (int)profiles.size(); i = nextDataset++)
+    ProfileDataset(hProject, i + 1, chunkSize, fMissingValue, profiles[i]);
+
+  SQ_CloseProject(&hProject);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=5 && argc!=6)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) the name of the profile file to write,\n"
+	       <<"3) the number of observations per chunk, 4) the number of worker threads\n"
+	       <<"and optionally 5) the value that marks missing data (NaN is always missing)\n";
+      return -1;
+    }
+
+  int chunkSize = std::atoi(argv[3]);
+  int numWorkers = std::atoi(argv[4]);
+  if(chunkSize<1 || numWorkers<1)
+    {
+      std::cout<<"\nThe chunk size and the number of workers must be positive integers\n";
+      return -1;
+    }
+  float fMissingValue = argc==6 ? std::strtof(argv[5], NULL) : NAN;
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND COUNT DATASETS
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  int numDatasets;
+  SQ_GetNumberOfDatasets(hProject, &numDatasets);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PROFILE ALL DATASETS
+  ////////////////////////////////////////////////////////////////////////
+
+  std::vector<DatasetProfile> profiles(numDatasets);
+  if(numWorkers == 1){
+    // A single worker uses the project that is already open
+    for(int i=0;i<numDatasets;i++)
+      ProfileDataset(hProject, i + 1, chunkSize, fMissingValue, profiles[i]);
+  }
+  else{
+    std::atomic<int> nextDataset{0};
+    std::vector<std::thread> workers;
+    for(int iWorker=0;iWorker<std::min(numWorkers, numDatasets);iWorker++)
+      workers.emplace_back(ProfileDatasetsOnCopy, szUSPFile, chunkSize, fMissingValue,
+			   std::ref(nextDataset), std::ref(profiles));
+    for(auto& worker : workers)
+      worker.join();
+  }
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// WRITE THE PROFILE FILE
+  ////////////////////////////////////////////////////////////////////////
+
+  const std::vector<double> quantiles = {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99};
+
+  std::ofstream file(argv[2]);
+  file << "dataset,variable,count,missing,mean,std,min,max";
+  for(double q : quantiles)
+    file << ",q" << q;
+  file << "\n";
+
+  for(auto const& profile : profiles){
+    if(!profile.error.empty() || profile.name.empty())
+      {
+	std::cout << "Dataset " << (profile.name.empty() ? "?" : profile.name) << " not profiled: "
+		  << (profile.error.empty() ? "project could not be opened" : profile.error) << std::endl;
+	continue;
+      }
+    for(auto const& variable : profile.variables){
+      file << profile.name << "," << variable.name << "," << variable.count << "," << variable.missing << ",";
+      if(variable.count > 0)
+	file << variable.mean << "," << variable.StdDev() << "," << variable.fMin << "," << variable.fMax;
+      else
+	file << ",,,";
+      for(double q : quantiles){
+	file << ",";
+	if(variable.count > 0)
+	  file << variable.sketch.Quantile(q);
+      }
+      file << "\n";
+    }
+    std::cout << "Profiled " << profile.name << ": " << profile.variables.size() << " variables, "
+	      << profile.numObservations << " observations" << std::endl;
+  }
+
+  if(!file)
+    {
+      std::cout << "Could not write " << argv[2] << std::endl;
+      return -1;
+    }
+
+  return 0;
+}
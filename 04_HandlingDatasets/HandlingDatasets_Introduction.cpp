@@ -150,6 +150,14 @@ int main(int argc,char* argv[])
   SQ_GetDataFromFloatMatrix (pMatrix, var, obs, &val);
   std::cout<<"Val: "<< val <<","<<std::endl;
 
+  // Release the handles handed out by SIMCA-Q
+  SQ_ClearFloatMatrix(&pMatrix);
+  SQ_ClearStringVector(&pRowNames);
+  SQ_ClearStringVector(&pColumnNames);
+  SQ_ClearVectorData(&pVectorData);
+  SQ_ClearVariableVector(&pVariableVector);
+  SQ_ClearStringVector(&pObservationNames);
+
   // Close the project
   eError = SQ_CloseProject(&hProject);
   hProject = NULL;
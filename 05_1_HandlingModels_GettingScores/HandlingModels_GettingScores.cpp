@@ -264,6 +264,12 @@ int main(int argc,char* argv[])
   float pfVal;
   SQ_GetDataFromFloatMatrix(hLoadingsDataMatrix, iVar, iComp, &pfVal);
   std::cout<<"Val: "<< pfVal << std::endl;
+
+  // Clear structure pointers
+  SQ_ClearFloatMatrix(&hLoadingsDataMatrix);
+  SQ_ClearStringVector(&hVariablesLoadingsVectorData);
+  SQ_ClearStringVector(&hComponentsLoadingsVectorData);
+  SQ_ClearVectorData(&hLoadingsVectorData);
   
 
 
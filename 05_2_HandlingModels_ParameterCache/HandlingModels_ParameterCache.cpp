@@ -0,0 +1,302 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include "SIMCAQP.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// CACHED BLOCK OF MODEL PARAMETERS
+//////////////////////////////////////////////////////////////////////////
+
+// Model quantities the cache knows how to fetch
+enum class Quantity { Scores, Loadings, Q2Cum, R2XCum };
+
+// Copy of a SQ_VectorData retrieved from SIMCA-Q. Values are stored row-major
+// in one contiguous vector, and rows can be looked up by name (observation
+// names for scores, variable names for loadings, component names for Q2(cum)
+// and R2X(cum)).
+struct ParameterBlock
+{
+  std::vector<std::string> rowNames;
+  std::vector<std::string> columnNames;
+  std::vector<int> components; // component number of every column
+  std::vector<float> values;
+  std::unordered_map<std::string, int> rowIndex; // 0-based
+
+  int NumRows() const { return (int)rowNames.size(); }
+  int NumColumns() const { return (int)columnNames.size(); }
+  float At(int iRow, int iColumn) const { return values[(size_t)iRow * columnNames.size() + iColumn]; }
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// LAZY PER-MODEL PARAMETER CACHE
+//////////////////////////////////////////////////////////////////////////
+
+// Retrieves model parameters from SIMCA-Q only the first time they are asked
+// for, and only for the requested components. Blocks are keyed by
+// (quantity, component subset); a request for components that are all part
+// of an already cached block of the same quantity is served from that block.
+class ModelParameterCache
+{
+public:
+  explicit ModelParameterCache(SQ_Model hModel) : m_hModel(hModel) {}
+
+  // Components are 1-based, as in SIMCA-Q. An empty list means all components.
+  // Returns NULL if SIMCA-Q could not deliver the quantity.
+  const ParameterBlock* Get(Quantity quantity, std::vector<int> components)
+  {
+    std::sort(components.begin(), components.end());
+    components.erase(std::unique(components.begin(), components.end()), components.end());
+
+    // Q2(cum) and R2X(cum) are always retrieved for all components
+    if(quantity == Quantity::Q2Cum || quantity == Quantity::R2XCum)
+      components.clear();
+
+    auto key = std::make_pair(quantity, components);
+    auto it = m_blocks.find(key);
+    if(it != m_blocks.end()){
+      m_hits++;
+      return &it->second;
+    }
+
+    // Reuse a cached block of the same quantity that already holds all the
+    // requested components (or every component, if it was fetched with NULL)
+    if(!components.empty()){
+      for(auto& [cachedKey, block] : m_blocks){
+	if(cachedKey.first != quantity)
+	  continue;
+	if(cachedKey.second.empty() ||
+	   std::includes(cachedKey.second.begin(), cachedKey.second.end(), components.begin(), components.end())){
+	  m_hits++;
+	  return &block;
+	}
+      }
+    }
+
+    m_misses++;
+    ParameterBlock block;
+    if(!Fetch(quantity, components, block))
+      return NULL;
+    return &m_blocks.emplace(key, std::move(block)).first->second;
+  }
+
+  // Value of one row (looked up by name) and one component.
+  // Returns false if the row or the component is not part of the model.
+  bool GetValue(Quantity quantity, const std::string& rowName, int iComponent, float& value)
+  {
+    std::vector<int> components;
+    if(quantity == Quantity::Scores || quantity == Quantity::Loadings)
+      components.push_back(iComponent);
+
+    const ParameterBlock* pBlock = Get(quantity, components);
+    if(pBlock == NULL)
+      return false;
+
+    auto row = pBlock->rowIndex.find(rowName);
+    if(row == pBlock->rowIndex.end())
+      return false;
+
+    // Q2(cum) and R2X(cum) have the components as rows and a single column
+    if(quantity == Quantity::Q2Cum || quantity == Quantity::R2XCum){
+      value = pBlock->At(row->second, 0);
+      return true;
+    }
+
+    auto column = std::find(pBlock->components.begin(), pBlock->components.end(), iComponent);
+    if(column == pBlock->components.end())
+      return false;
+    value = pBlock->At(row->second, int(column - pBlock->components.begin()));
+    return true;
+  }
+
+  // Drop everything, e.g. after the model has been refitted
+  void Clear() { m_blocks.clear(); }
+
+  size_t Hits() const { return m_hits; }
+  size_t Misses() const { return m_misses; }
+
+private:
+  bool Fetch(Quantity quantity, const std::vector<int>& components, ParameterBlock& block)
+  {
+    // Handle for the subset of components to retrieve. NULL retrieves all of them.
+    SQ_IntVector hComponents = NULL;
+    if(!components.empty()){
+      SQ_InitIntVector(&hComponents, (int)components.size());
+      for(size_t i = 0; i < components.size(); i++)
+	SQ_SetDataInIntVector(hComponents, int(i + 1), components[i]);
+    }
+
+    SQ_VectorData hVectorData = NULL;
+    SQ_ErrorCode eError = SQ_E_OK;
+    SQ_IntVector* pComponents = hComponents ? &hComponents : NULL;
+    switch(quantity)
+      {
+      case Quantity::Scores:
+	eError = SQ_GetT(m_hModel, pComponents, &hVectorData);
+	break;
+      case Quantity::Loadings:
+	eError = SQ_GetP(m_hModel, pComponents, SQ_Reconstruct_False, &hVectorData);
+	break;
+      case Quantity::Q2Cum:
+	eError = SQ_GetQ2Cum(m_hModel, &hVectorData);
+	break;
+      case Quantity::R2XCum:
+	eError = SQ_GetR2XCum(m_hModel, &hVectorData);
+	break;
+      }
+
+    if(hComponents)
+      SQ_ClearIntVector(&hComponents);
+    if(eError != SQ_E_OK)
+      return false;
+
+    char szBuffer[256];
+    int numStrings;
+
+    SQ_StringVector hRowNames = NULL;
+    SQ_GetRowNames(hVectorData, &hRowNames);
+    SQ_GetNumStringsInVector(hRowNames, &numStrings);
+    block.rowNames.reserve(numStrings);
+    for(int i=1;i<=numStrings;i++){
+      SQ_GetStringFromVector(hRowNames, i, szBuffer, sizeof(szBuffer));
+      block.rowNames.push_back(szBuffer);
+      block.rowIndex[szBuffer] = i - 1;
+    }
+    SQ_ClearStringVector(&hRowNames);
+
+    SQ_StringVector hColumnNames = NULL;
+    SQ_GetColumnNames(hVectorData, &hColumnNames);
+    SQ_GetNumStringsInVector(hColumnNames, &numStrings);
+    block.columnNames.reserve(numStrings);
+    for(int i=1;i<=numStrings;i++){
+      SQ_GetStringFromVector(hColumnNames, i, szBuffer, sizeof(szBuffer));
+      block.columnNames.push_back(szBuffer);
+      block.components.push_back(components.empty() ? i : components[i - 1]);
+    }
+    SQ_ClearStringVector(&hColumnNames);
+
+    SQ_FloatMatrix hMatrix = NULL;
+    SQ_GetDataMatrix(hVectorData, &hMatrix);
+    int numRows, numColumns;
+    SQ_GetNumRowsInFloatMatrix(hMatrix, &numRows);
+    SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+    block.values.resize((size_t)numRows * numColumns);
+    for(int iRow=1;iRow<=numRows;iRow++){
+      for(int iColumn=1;iColumn<=numColumns;iColumn++){
+	SQ_GetDataFromFloatMatrix(hMatrix, iRow, iColumn, &block.values[(size_t)(iRow - 1) * numColumns + iColumn - 1]);
+      }
+    }
+    SQ_ClearFloatMatrix(&hMatrix);
+    SQ_ClearVectorData(&hVectorData);
+
+    return true;
+  }
+
+  SQ_Model m_hModel;
+  std::map<std::pair<Quantity, std::vector<int>>, ParameterBlock> m_blocks;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc<4)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a variable name and 3) one or more component numbers\n";
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+
+  // Load the project
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  // Load the model with index = 1
+  SQ_Model hModel = NULL;
+  int iModelIndex = 1;
+  int iModelNumber;
+  SQ_Bool bIsFitted;
+  eError = SQ_GetModelNumberFromIndex(hProject, iModelIndex, &iModelNumber);
+  eError = SQ_GetModel(hProject, iModelNumber, &hModel);
+  // Check if model is correct (=fitted)
+  if (SQ_IsModelFitted(hModel, &bIsFitted) != SQ_E_OK || bIsFitted != SQ_True)
+    return -1;
+
+  std::string variableName = argv[2];
+  std::vector<int> components;
+  for(int i=3;i<argc;i++)
+    components.push_back(std::atoi(argv[i]));
+
+  ModelParameterCache cache(hModel);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOADINGS FOR ONE VARIABLE
+  ////////////////////////////////////////////////////////////////////////
+
+  // Only the requested components are retrieved from SIMCA-Q, and only once.
+  // The repeated queries below are all served from memory.
+  // Asking for all components up front makes it a single SQ_GetP() call.
+  if(cache.Get(Quantity::Loadings, components) == NULL)
+    {
+      std::cout << "Could not retrieve the loadings of the requested components" << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+  float pfVal;
+  for(int iQuery=0;iQuery<1000;iQuery++){
+    for(int iComp : components){
+      if(!cache.GetValue(Quantity::Loadings, variableName, iComp, pfVal))
+	{
+	  std::cout << "No loading for variable " << variableName << " and component " << iComp << std::endl;
+	  SQ_CloseProject(&hProject);
+	  return -1;
+	}
+      if(iQuery==0)
+	std::cout << "Loading of " << variableName << " for component " << iComp << ": " << pfVal << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// SUMMARY OF FIT PARAMETERS
+  ////////////////////////////////////////////////////////////////////////
+
+  const ParameterBlock* pQ2Cum = cache.Get(Quantity::Q2Cum, {});
+  const ParameterBlock* pR2XCum = cache.Get(Quantity::R2XCum, {});
+  if(pQ2Cum != NULL && pR2XCum != NULL){
+    for(int iComp=0;iComp<pQ2Cum->NumRows() && iComp<pR2XCum->NumRows();iComp++){
+      std::cout << pQ2Cum->rowNames[iComp] << ": Q2(cum) = " << pQ2Cum->At(iComp, 0)
+		<< ", R2X(cum) = " << pR2XCum->At(iComp, 0) << std::endl;
+    }
+  }
+
+  std::cout << "Cache hits: " << cache.Hits() << ", SIMCA-Q retrievals: " << cache.Misses() << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE THE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  // The cache does not hold any SIMCA-Q handle, so it is safe to close
+  // the project while the cache is still alive
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
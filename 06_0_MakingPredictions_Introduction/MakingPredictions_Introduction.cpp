@@ -269,6 +269,8 @@ int main(int argc,char* argv[])
   //////////// CLEAR HANDLES
   ////////////////////////////////////////////////////////////////////////
 
+  SQ_ClearVariableVector(&hPredictionVariables);
+  hPredictionVariables = NULL;
   SQ_ClearPreparePrediction(&hPreparePrediction);
   hPreparePrediction = NULL;
   SQ_ClearPrediction (&hPredictionHandle);
@@ -283,6 +285,12 @@ int main(int argc,char* argv[])
   hPredictiveComponentNames = NULL;
   SQ_ClearFloatMatrix(&hPredictedPredictiveComponentsDataMatrix);
   hPredictedPredictiveComponentsDataMatrix = NULL;
+  SQ_ClearVectorData(&hPredictedPredictiveComponents);
+  hPredictedPredictiveComponents = NULL;
+  SQ_ClearStringVector(&hObservationNames);
+  hObservationNames = NULL;
+  SQ_ClearStringVector(&hYVariableNames);
+  hYVariableNames = NULL;
 
 
   ////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,196 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+#include "PredictionRing.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// COPY ONE PREDICTED QUANTITY
+//////////////////////////////////////////////////////////////////////////
+
+// Copies the values of observation 1 of a SQ_VectorData into fValues
+void CopyObservation(SQ_VectorData hVectorData, std::vector<float>& fValues)
+{
+  SQ_FloatMatrix hMatrix = NULL;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  int numColumns;
+  SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+  fValues.resize(size_t(numColumns));
+  for(int iCol=1;iCol<=numColumns;iCol++)
+    SQ_GetDataFromFloatMatrix(hMatrix, 1, iCol, &fValues[size_t(iCol - 1)]);
+  SQ_ClearFloatMatrix(&hMatrix);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=7 && !(argc==8 && strcmp(argv[7],"replace")==0))
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file,\n"
+	       <<"4) the name of the shared memory ring, e.g. /simcaq_predictions, 5) the number of\n"
+	       <<"records the ring holds, 6) how many times to predict all rows of the input file\n"
+	       <<"and optionally 7) the word replace to replace a ring with the same name\n";
+      return -1;
+    }
+  bool bReplace = argc==8;
+
+  int capacity = std::atoi(argv[5]);
+  int numPasses = std::atoi(argv[6]);
+  if(argv[4][0]!='/' || capacity<1 || numPasses<1)
+    {
+      std::cout<<"\nThe ring name must start with '/', and the capacity and the number of passes\n"
+	       <<"must be positive integers\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cerr << "Could not read any observation from " << argv[3] << std::endl;
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cerr << szError << std::endl;
+      return -1;
+    }
+
+  int modelNumber;
+  SQ_Model hModel = FindFittedModel(hProject, argv[2], &modelNumber);
+  if (hModel == NULL)
+    {
+      std::cerr << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREPARE PREDICTION
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::vector<std::pair<int, size_t>> binding; // (SIMCA-Q variable, input column)
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+    if(res!=inputVariables.end())
+      binding.emplace_back(iVar, size_t(res - inputVariables.begin()));
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  if(!DropShortRows(rows, RequiredValues(binding)))
+    {
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT AND PUBLISH EVERY RESULT
+  ////////////////////////////////////////////////////////////////////////
+
+  // The ring is created after the first prediction, when the number of
+  // scores and predicted Y values per record is known
+  PredictionRing::Writer ring;
+  bool bRingCreated = false;
+
+  std::vector<float> fScores, fYValues;
+  size_t numPublished = 0;
+  auto start = std::chrono::steady_clock::now();
+  for(int iPass=0;iPass<numPasses;iPass++){
+    for(auto const& row : rows){
+      for(auto const& [iVar, position] : binding)
+	SQ_SetQuantitativeData(hPreparePrediction, 1, iVar, row[position]);
+
+      SQ_Prediction hPredictionHandle = NULL;
+      if(SQ_GetPrediction(hPreparePrediction, &hPredictionHandle) != SQ_E_OK)
+	continue;
+
+      fScores.clear();
+      fYValues.clear();
+      SQ_VectorData hPredictedScores = NULL;
+      if(SQ_GetTPS(hPredictionHandle, NULL, &hPredictedScores) == SQ_E_OK){
+	CopyObservation(hPredictedScores, fScores);
+	SQ_ClearVectorData(&hPredictedScores);
+      }
+      SQ_VectorData hPredictedYs = NULL;
+      if(SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True,
+		       NULL, &hPredictedYs) == SQ_E_OK){
+	CopyObservation(hPredictedYs, fYValues);
+	SQ_ClearVectorData(&hPredictedYs);
+      }
+      SQ_ClearPrediction(&hPredictionHandle);
+
+      if(!bRingCreated){
+	if(!ring.Create(argv[4], (uint32_t)capacity, uint32_t(fScores.size() + fYValues.size()), bReplace))
+	  {
+	    std::cerr << "Could not create the shared memory ring " << argv[4] << ": " << strerror(errno) << std::endl;
+	    if(errno == EEXIST)
+	      std::cerr << "Pass replace as the last parameter to replace it" << std::endl;
+	    break;
+	  }
+	bRingCreated = true;
+	std::cout << "Publishing to " << argv[4] << ": " << fScores.size() << " scores and "
+		  << fYValues.size() << " predicted Y values per record" << std::endl;
+      }
+      ring.Publish((uint32_t)modelNumber, fScores.data(), fScores.size(), fYValues.data(), fYValues.size());
+      numPublished++;
+    }
+    if(!bRingCreated)
+      break;
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "Published " << numPublished << " records to " << argv[4] << " in "
+	    << elapsed.count() << " s" << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES, CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
@@ -0,0 +1,296 @@
+// Prediction results in a POSIX shared-memory ring buffer.
+//
+// One prediction process (the single producer) publishes a record per
+// predicted observation; any number of local processes (the consumers) map
+// the same memory read-only and read the records in place. The producer
+// never waits for consumers: a consumer that falls more than one ring
+// behind detects that its records were overwritten and skips ahead.
+//
+// Layout of the shared memory object, all fields in native byte order:
+//
+//   Ring header, 128 bytes
+//     offset 0   uint32  magic "SQPR", written last when the ring is ready
+//     offset 4   uint32  layout version (1)
+//     offset 8   uint32  capacity, number of record slots, a power of 2
+//     offset 12  uint32  record size in bytes, a multiple of 64
+//     offset 16  uint32  maximum number of values per record, at most 65535
+//     offset 64  uint64  number of records published so far (atomic)
+//
+//   Record slot n % capacity for record n, record size bytes, 64-byte aligned
+//     offset 0   uint64  sequence (atomic): 2n+1 while record n is being
+//                        written, 2n+2 once it is complete
+//     offset 8   int64   timestamp, nanoseconds since the Unix epoch
+//     offset 16  uint32  model number
+//     offset 20  uint16  number of scores (TPS values)
+//     offset 22  uint16  number of predicted Y values (YPredPS values)
+//     offset 24  float32 the scores, followed by the predicted Y values
+//
+// A consumer reads a record in place and afterwards checks that its
+// sequence has not changed (a sequence lock), so a record that was
+// overwritten while being read is never mistaken for a valid one.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace PredictionRing
+{
+  constexpr uint32_t kMagic = 0x52505153; // "SQPR" in little-endian byte order
+  constexpr uint32_t kVersion = 1;
+  // The counts in a record are 16 bits wide
+  constexpr uint32_t kMaxValues = 65535;
+  constexpr uint32_t kMaxCapacity = uint32_t(1) << 31;
+
+  static_assert(std::atomic<uint64_t>::is_always_lock_free,
+		"the ring needs lock-free 64-bit atomics to be shared between processes");
+
+  struct RingHeader
+  {
+    std::atomic<uint32_t> magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t recordSize;
+    uint32_t maxValues;
+    uint8_t reserved[44];
+    std::atomic<uint64_t> published;
+    uint8_t reserved2[56];
+  };
+  static_assert(sizeof(RingHeader) == 128 && offsetof(RingHeader, published) == 64, "ring header layout");
+
+  struct RecordHeader
+  {
+    std::atomic<uint64_t> sequence;
+    int64_t timestampNs;
+    uint32_t modelNumber;
+    uint16_t numScores;
+    uint16_t numYValues;
+  };
+  static_assert(sizeof(RecordHeader) == 24, "record header layout");
+
+  inline size_t RecordSize(uint32_t maxValues)
+  {
+    return (sizeof(RecordHeader) + size_t(maxValues) * sizeof(float) + 63) / 64 * 64;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// PRODUCER
+  //////////////////////////////////////////////////////////////////////////
+
+  class Writer
+  {
+  public:
+    Writer() = default;
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    // Removes the name when the producer exits. Consumers that still have
+    // the ring mapped keep reading it; new consumers cannot attach anymore.
+    ~Writer()
+    {
+      if(m_pBase){
+	munmap(m_pBase, m_size);
+	shm_unlink(m_name.c_str());
+      }
+    }
+
+    // Creates the shared memory object. name must start with '/', e.g.
+    // "/simcaq_predictions". capacity is rounded up to a power of 2. Fails
+    // with errno EEXIST if the name is already in use, e.g. by another
+    // producer, unless bReplace is set, in which case the old object is
+    // unlinked first. Its consumers keep reading the old object.
+    bool Create(const std::string& name, uint32_t capacity, uint32_t maxValues, bool bReplace = false)
+    {
+      if(m_pBase || capacity == 0 || capacity > kMaxCapacity || maxValues > kMaxValues){
+	errno = EINVAL;
+	return false;
+      }
+
+      uint32_t roundedCapacity = 1;
+      while(roundedCapacity < capacity)
+	roundedCapacity *= 2;
+
+      m_name = name;
+      m_recordSize = RecordSize(maxValues);
+      m_size = sizeof(RingHeader) + size_t(roundedCapacity) * m_recordSize;
+
+      if(bReplace)
+	shm_unlink(name.c_str());
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+      if(fd < 0)
+	return false;
+      if(ftruncate(fd, (off_t)m_size) != 0){
+	close(fd);
+	shm_unlink(name.c_str());
+	return false;
+      }
+      void* pBase = mmap(NULL, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if(pBase == MAP_FAILED){
+	shm_unlink(name.c_str());
+	return false;
+      }
+      m_pBase = static_cast<uint8_t*>(pBase);
+
+      // ftruncate() zero-fills, so every slot starts with sequence 0
+      m_pHeader = reinterpret_cast<RingHeader*>(m_pBase);
+      m_pHeader->version = kVersion;
+      m_pHeader->capacity = roundedCapacity;
+      m_pHeader->recordSize = (uint32_t)m_recordSize;
+      m_pHeader->maxValues = maxValues;
+      m_pHeader->published.store(0, std::memory_order_relaxed);
+      m_pHeader->magic.store(kMagic, std::memory_order_release);
+      return true;
+    }
+
+    // Publishes one record. Values beyond the maximum of the ring are cut off.
+    void Publish(uint32_t modelNumber, const float* pScores, size_t numScores,
+		 const float* pYValues, size_t numYValues)
+    {
+      numScores = std::min<size_t>(numScores, m_pHeader->maxValues);
+      numYValues = std::min<size_t>(numYValues, m_pHeader->maxValues - numScores);
+
+      uint64_t n = m_pHeader->published.load(std::memory_order_relaxed);
+      uint8_t* pSlot = m_pBase + sizeof(RingHeader) + size_t(n & (m_pHeader->capacity - 1)) * m_recordSize;
+      RecordHeader* pRecord = reinterpret_cast<RecordHeader*>(pSlot);
+      float* pValues = reinterpret_cast<float*>(pSlot + sizeof(RecordHeader));
+
+      pRecord->sequence.store(2 * n + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+
+      pRecord->timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+      pRecord->modelNumber = modelNumber;
+      pRecord->numScores = (uint16_t)numScores;
+      pRecord->numYValues = (uint16_t)numYValues;
+      std::memcpy(pValues, pScores, numScores * sizeof(float));
+      std::memcpy(pValues + numScores, pYValues, numYValues * sizeof(float));
+
+      pRecord->sequence.store(2 * n + 2, std::memory_order_release);
+      m_pHeader->published.store(n + 1, std::memory_order_release);
+    }
+
+  private:
+    std::string m_name;
+    uint8_t* m_pBase = NULL;
+    size_t m_size = 0;
+    size_t m_recordSize = 0;
+    RingHeader* m_pHeader = NULL;
+  };
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// CONSUMERS
+  //////////////////////////////////////////////////////////////////////////
+
+  // A record read in place. The pointers point into the shared memory.
+  struct RecordView
+  {
+    int64_t timestampNs;
+    uint32_t modelNumber;
+    uint16_t numScores;
+    uint16_t numYValues;
+    const float* pScores;
+    const float* pYValues;
+  };
+
+  enum class ReadStatus { Ok, NotYetPublished, Overwritten };
+
+  class Reader
+  {
+  public:
+    Reader() = default;
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader()
+    {
+      if(m_pBase)
+	munmap(const_cast<uint8_t*>(m_pBase), m_size);
+    }
+
+    // Maps an existing ring read-only. Fails if it does not exist yet or
+    // has not been initialized completely by the producer.
+    bool Open(const std::string& name)
+    {
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+      if(fd < 0)
+	return false;
+      struct stat info;
+      if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(RingHeader)){
+	close(fd);
+	return false;
+      }
+      void* pBase = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if(pBase == MAP_FAILED)
+	return false;
+      // Slot() masks with capacity - 1 and Read() trusts maxValues, so a
+      // header that does not hold what Create() writes is rejected
+      const RingHeader* pHeader = static_cast<const RingHeader*>(pBase);
+      if(pHeader->magic.load(std::memory_order_acquire) != kMagic || pHeader->version != kVersion ||
+	 pHeader->capacity == 0 || (pHeader->capacity & (pHeader->capacity - 1)) != 0 ||
+	 pHeader->maxValues > kMaxValues || pHeader->recordSize < RecordSize(pHeader->maxValues) ||
+	 (size_t)info.st_size < sizeof(RingHeader) + size_t(pHeader->capacity) * pHeader->recordSize){
+	munmap(pBase, (size_t)info.st_size);
+	return false;
+      }
+      m_pBase = static_cast<const uint8_t*>(pBase);
+      m_size = (size_t)info.st_size;
+      m_pHeader = pHeader;
+      return true;
+    }
+
+    uint32_t Capacity() const { return m_pHeader->capacity; }
+
+    // Number of records published so far; the next record will be number Published()
+    uint64_t Published() const { return m_pHeader->published.load(std::memory_order_acquire); }
+
+    // Fills view with pointers to record n. The values may be overwritten
+    // by the producer while the consumer uses them, so check IsIntact(n)
+    // once done with them.
+    ReadStatus Read(uint64_t n, RecordView& view) const
+    {
+      const RecordHeader* pRecord = Slot(n);
+      uint64_t sequence = pRecord->sequence.load(std::memory_order_acquire);
+      if(sequence < 2 * n + 2)
+	return ReadStatus::NotYetPublished;
+      if(sequence > 2 * n + 2)
+	return ReadStatus::Overwritten;
+
+      view.timestampNs = pRecord->timestampNs;
+      view.modelNumber = pRecord->modelNumber;
+      view.numScores = std::min<uint16_t>(pRecord->numScores, (uint16_t)m_pHeader->maxValues);
+      view.numYValues = std::min<uint16_t>(pRecord->numYValues, uint16_t(m_pHeader->maxValues - view.numScores));
+      view.pScores = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pRecord) + sizeof(RecordHeader));
+      view.pYValues = view.pScores + view.numScores;
+      return IsIntact(n) ? ReadStatus::Ok : ReadStatus::Overwritten;
+    }
+
+    // True if record n was still the complete record in its slot after
+    // everything read from it so far
+    bool IsIntact(uint64_t n) const
+    {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return Slot(n)->sequence.load(std::memory_order_relaxed) == 2 * n + 2;
+    }
+
+  private:
+    const RecordHeader* Slot(uint64_t n) const
+    {
+      return reinterpret_cast<const RecordHeader*>(m_pBase + sizeof(RingHeader) +
+						   size_t(n & (m_pHeader->capacity - 1)) * m_pHeader->recordSize);
+    }
+
+    const uint8_t* m_pBase = NULL;
+    size_t m_size = 0;
+    const RingHeader* m_pHeader = NULL;
+  };
+}
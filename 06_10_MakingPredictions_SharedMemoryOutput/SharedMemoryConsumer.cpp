@@ -0,0 +1,103 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+#include "PredictionRing.h"
+
+// A consumer of the shared memory ring. It does not use SIMCA-Q: it maps the
+// ring read-only and prints every record as a CSV line, reading the values
+// in place.
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=3)
+    {
+      std::cout<<"\nYou need to pass 1) the name of the shared memory ring, e.g. /simcaq_predictions,\n"
+	       <<"and 2) the number of seconds without new records after which to stop\n";
+      return -1;
+    }
+
+  int idleSeconds = std::atoi(argv[2]);
+  if(idleSeconds<1)
+    {
+      std::cout<<"\nThe number of seconds must be a positive integer\n";
+      return -1;
+    }
+  const auto idleTimeout = std::chrono::seconds(idleSeconds);
+  const auto pollInterval = std::chrono::microseconds(200);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// ATTACH TO THE RING
+  ////////////////////////////////////////////////////////////////////////
+
+  // The producer creates the ring after its first prediction, so wait for it
+  PredictionRing::Reader ring;
+  auto lastActivity = std::chrono::steady_clock::now();
+  while(!ring.Open(argv[1])){
+    if(std::chrono::steady_clock::now() - lastActivity > idleTimeout)
+      {
+	std::cerr << "Could not open the shared memory ring " << argv[1] << std::endl;
+	return -1;
+      }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  lastActivity = std::chrono::steady_clock::now();
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// READ RECORDS UNTIL THE PRODUCER STOPS
+  ////////////////////////////////////////////////////////////////////////
+
+  // Start with the oldest record still in the ring. The slot of record
+  // Published() - Capacity() may already be being overwritten.
+  uint64_t published = ring.Published();
+  uint64_t next = published >= ring.Capacity() ? published - ring.Capacity() + 1 : 0;
+  uint64_t numRead = 0, numLost = 0;
+
+  PredictionRing::RecordView view;
+  while(true){
+    switch(ring.Read(next, view)){
+    case PredictionRing::ReadStatus::NotYetPublished:
+      if(std::chrono::steady_clock::now() - lastActivity > idleTimeout)
+	break;
+      std::this_thread::sleep_for(pollInterval);
+      continue;
+
+    case PredictionRing::ReadStatus::Overwritten:
+      {
+	// This consumer fell more than one ring behind: skip to the oldest
+	// record that is still there
+	uint64_t oldest = ring.Published() - ring.Capacity() + 1;
+	numLost += oldest - next;
+	next = oldest;
+	continue;
+      }
+
+    case PredictionRing::ReadStatus::Ok:
+      {
+	// Format the values straight from the shared memory, then check that
+	// the producer did not overwrite them meanwhile
+	std::string line = std::to_string(next) + "," + std::to_string(view.timestampNs) + "," +
+	  std::to_string(view.modelNumber);
+	for(uint16_t i = 0; i < view.numScores; i++)
+	  line += "," + std::to_string(view.pScores[i]);
+	for(uint16_t i = 0; i < view.numYValues; i++)
+	  line += "," + std::to_string(view.pYValues[i]);
+	if(!ring.IsIntact(next))
+	  continue; // Read() will now report it as overwritten
+
+	std::cout << line << "\n";
+	numRead++;
+	next++;
+	lastActivity = std::chrono::steady_clock::now();
+	continue;
+      }
+    }
+    break;
+  }
+
+  std::cerr << "Read " << numRead << " records, lost " << numLost << " that were overwritten before they were read"
+	    << std::endl;
+  return 0;
+}
@@ -0,0 +1,446 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// BOUNDED LOCK-FREE QUEUE BETWEEN TWO STAGES
+//////////////////////////////////////////////////////////////////////////
+
+// What a producer does when the queue in front of the next stage is full
+enum class Backpressure { Block, Drop };
+
+// Single-producer/single-consumer ring buffer. Each queue links exactly two
+// stages, so one atomic index per side is all the synchronization needed.
+// The queue also records how deep it was every time an item was pushed,
+// which is what the per-stage metrics printed at the end are built from.
+template <typename T>
+class SPSCQueue
+{
+public:
+  SPSCQueue(size_t capacity, Backpressure policy)
+    : m_buffer(capacity + 1), m_policy(policy) {}
+
+  // Returns false only when the item was dropped because of backpressure
+  bool Push(T item)
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % m_buffer.size();
+    if(next == m_head.load(std::memory_order_acquire)){
+      m_fullEvents++;
+      if(m_policy == Backpressure::Drop){
+	m_dropped++;
+	return false;
+      }
+      while(next == m_head.load(std::memory_order_acquire))
+	std::this_thread::yield();
+    }
+    m_buffer[tail] = std::move(item);
+    m_tail.store(next, std::memory_order_release);
+
+    size_t depth = Depth();
+    m_depthSum += depth;
+    m_pushes++;
+    if(depth > m_maxDepth)
+      m_maxDepth = depth;
+    return true;
+  }
+
+  // Waits for free space whatever the policy, and is not counted in the
+  // metrics. Used for the end-of-stream item, which must never be dropped.
+  void PushEndOfStream(T item)
+  {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t next = (tail + 1) % m_buffer.size();
+    while(next == m_head.load(std::memory_order_acquire))
+      std::this_thread::yield();
+    m_buffer[tail] = std::move(item);
+    m_tail.store(next, std::memory_order_release);
+  }
+
+  // Blocks (spinning politely) until an item is available
+  T Pop()
+  {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    while(head == m_tail.load(std::memory_order_acquire))
+      std::this_thread::yield();
+    T item = std::move(m_buffer[head]);
+    m_head.store((head + 1) % m_buffer.size(), std::memory_order_release);
+    return item;
+  }
+
+  size_t Depth() const
+  {
+    size_t head = m_head.load(std::memory_order_acquire);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    return (tail + m_buffer.size() - head) % m_buffer.size();
+  }
+
+  void PrintMetrics(const std::string& name) const
+  {
+    std::cerr << "Queue " << name << ": capacity " << m_buffer.size() - 1
+	      << ", max depth " << m_maxDepth
+	      << ", mean depth " << (m_pushes ? double(m_depthSum) / m_pushes : 0.0)
+	      << ", full " << m_fullEvents << " times"
+	      << ", dropped " << m_dropped << " items" << std::endl;
+  }
+
+private:
+  std::vector<T> m_buffer;
+  Backpressure m_policy;
+  std::atomic<size_t> m_head{0};
+  std::atomic<size_t> m_tail{0};
+  // Only touched by the producer thread
+  size_t m_pushes = 0;
+  size_t m_depthSum = 0;
+  size_t m_maxDepth = 0;
+  size_t m_fullEvents = 0;
+  size_t m_dropped = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// ITEMS FLOWING THROUGH THE PIPELINE
+//////////////////////////////////////////////////////////////////////////
+
+// One observation read from an input file. All rows of the same file share
+// the pointer to its header so the SIMCA-Q stage only has to match the
+// variable names once per file.
+struct InputRow
+{
+  bool bEndOfStream = false;
+  std::string fileName;
+  int iRow = 0;
+  std::shared_ptr<const std::vector<std::string>> inputVariables;
+  std::vector<float> fQuantitativeData;
+  std::string error; // set by the parser when the row could not be read
+};
+
+struct PredictionResult
+{
+  bool bEndOfStream = false;
+  bool bOk = false;
+  std::string error;
+  std::string fileName;
+  int iRow = 0;
+  std::vector<float> fScores;
+  std::vector<float> fYValues;
+};
+
+// Busy time of a stage, i.e. the time spent working and not waiting on a queue
+struct StageTimer
+{
+  std::chrono::steady_clock::duration busy{};
+  size_t items = 0;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// STAGE 1: INPUT PARSER
+//////////////////////////////////////////////////////////////////////////
+
+// Reads files with the same layout as sampleSpectrum.csv: a first row with
+// the variable names followed by one or more rows of values. A row that
+// cannot be parsed is still passed on, with its error, so that it shows up
+// in the output.
+void ParserStage(const std::vector<std::string>& fileNames, SPSCQueue<InputRow>& outQueue, StageTimer& timer)
+{
+  for(const auto& fileName : fileNames){
+    auto start = std::chrono::steady_clock::now();
+
+    std::ifstream file(fileName);
+    std::string line, word;
+    auto inputVariables = std::make_shared<std::vector<std::string>>();
+    if(std::getline(file, line)){
+      std::stringstream s(line);
+      while (std::getline(s, word, ',')) {
+	inputVariables->push_back(word);
+      }
+    }
+    timer.busy += std::chrono::steady_clock::now() - start;
+
+    int iRow = 0;
+    while(true){
+      start = std::chrono::steady_clock::now();
+      if(!std::getline(file, line))
+	break;
+      if(line.empty())
+	continue;
+      InputRow row;
+      row.fileName = fileName;
+      row.iRow = ++iRow;
+      row.inputVariables = inputVariables;
+      row.fQuantitativeData.reserve(inputVariables->size());
+      if(!ParseRow(line, row.fQuantitativeData))
+	row.error = "a value is not a number";
+      timer.busy += std::chrono::steady_clock::now() - start;
+      timer.items++;
+      outQueue.Push(std::move(row));
+    }
+  }
+
+  InputRow endOfStream;
+  endOfStream.bEndOfStream = true;
+  outQueue.PushEndOfStream(std::move(endOfStream));
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// STAGE 3: OUTPUT SERIALIZER
+//////////////////////////////////////////////////////////////////////////
+
+void WriterStage(SPSCQueue<PredictionResult>& inQueue, StageTimer& timer)
+{
+  while(true){
+    PredictionResult result = inQueue.Pop();
+    if(result.bEndOfStream)
+      break;
+
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream out;
+    out << result.fileName << "," << result.iRow;
+    if(!result.bOk)
+      out << "," << (result.error.empty() ? "prediction failed" : result.error);
+    for(float fScore : result.fScores)
+      out << "," << fScore;
+    for(float fYValue : result.fYValues)
+      out << "," << fYValue;
+    out << "\n";
+    std::cout << out.str();
+    timer.busy += std::chrono::steady_clock::now() - start;
+    timer.items++;
+  }
+  std::cout.flush();
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc<6)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the capacity of the queues between stages,\n"
+	       <<"4) the backpressure policy (block or drop) and 5) the name of one or more input files\n";
+      return -1;
+    }
+
+  int queueCapacity = std::atoi(argv[3]);
+  if(queueCapacity<1)
+    {
+      std::cout<<"\nThe queue capacity must be a positive integer\n";
+      return -1;
+    }
+
+  Backpressure policy;
+  if(strcmp(argv[4],"block")==0)
+    policy = Backpressure::Block;
+  else if(strcmp(argv[4],"drop")==0)
+    policy = Backpressure::Drop;
+  else
+    {
+      std::cout<<"\nThe backpressure policy must be either block or drop\n";
+      return -1;
+    }
+
+  std::vector<std::string> fileNames(argv + 5, argv + argc);
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  // All SIMCA-Q handles are created, used and cleared on this thread only,
+  // i.e. the SIMCA-Q stage of the pipeline runs on the main thread
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE VARIABLE-POSITION DICTIONARY (ONCE)
+  ////////////////////////////////////////////////////////////////////////
+
+  // The SQ_PreparePrediction handle is kept for all rows of a file. Every
+  // row overwrites the values of observation 1 before asking for a prediction.
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::map<std::string, int> DataLookup;
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    DataLookup[szBuffer] = iVar;
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// START THE PARSER AND WRITER STAGES
+  ////////////////////////////////////////////////////////////////////////
+
+  SPSCQueue<InputRow> inputQueue(queueCapacity, policy);
+  SPSCQueue<PredictionResult> outputQueue(queueCapacity, policy);
+  StageTimer parserTimer, predictTimer, writerTimer;
+
+  auto wallStart = std::chrono::steady_clock::now();
+  std::thread parserThread(ParserStage, std::cref(fileNames), std::ref(inputQueue), std::ref(parserTimer));
+  std::thread writerThread(WriterStage, std::ref(outputQueue), std::ref(writerTimer));
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// STAGE 2: BIND AND PREDICT
+  ////////////////////////////////////////////////////////////////////////
+
+  // (SQ_SetQuantitativeData slot, position in the input row) pairs, computed
+  // once per distinct input header. The header itself is held, not its
+  // address, since a freed header's address can be reused by the next file.
+  std::shared_ptr<const std::vector<std::string>> pCurrentHeader;
+  std::vector<std::pair<int,int>> binding;
+  size_t numRequiredValues = 0; // one past the last bound position
+
+  while(true){
+    InputRow row = inputQueue.Pop();
+    if(row.bEndOfStream)
+      break;
+
+    auto start = std::chrono::steady_clock::now();
+
+    if(row.inputVariables != pCurrentHeader){
+      // A new file may lack variables that the previous one had, so start
+      // again from a handle where every value is missing
+      if(pCurrentHeader){
+	SQ_ClearPreparePrediction(&hPreparePrediction);
+	SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+      }
+      binding.clear();
+      for (auto const& [key, val] : DataLookup){
+	auto res = std::find(row.inputVariables->begin(), row.inputVariables->end(), key);
+	if(res!=row.inputVariables->end())
+	  binding.emplace_back(val, int(res - row.inputVariables->begin()));
+      }
+      numRequiredValues = RequiredValues(binding);
+      pCurrentHeader = row.inputVariables;
+    }
+
+    PredictionResult result;
+    result.fileName = row.fileName;
+    result.iRow = row.iRow;
+
+    // A short row would leave values of the previous row in the handle, so
+    // it is reported instead of predicted
+    if(row.error.empty() && row.fQuantitativeData.size() < numRequiredValues)
+      row.error = "row too short";
+    result.error = row.error;
+
+    if(row.error.empty()){
+      for(auto const& [iVar, position] : binding)
+	SQ_SetQuantitativeData(hPreparePrediction, 1, iVar, row.fQuantitativeData[position]);
+    }
+
+    SQ_Prediction hPredictionHandle = NULL;
+    if(row.error.empty() && SQ_GetPrediction(hPreparePrediction, &hPredictionHandle) == SQ_E_OK){
+      float fValue;
+      int numColumns;
+
+      SQ_VectorData hPredictedPredictiveComponents = NULL;
+      SQ_FloatMatrix hScoresMatrix = NULL;
+      SQ_GetTPS(hPredictionHandle, NULL, &hPredictedPredictiveComponents);
+      SQ_GetDataMatrix(hPredictedPredictiveComponents, &hScoresMatrix);
+      SQ_GetNumColumnsInFloatMatrix(hScoresMatrix, &numColumns);
+      for(int iComp=1;iComp<=numColumns;iComp++){
+	SQ_GetDataFromFloatMatrix(hScoresMatrix, 1, iComp, &fValue);
+	result.fScores.push_back(fValue);
+      }
+      SQ_ClearFloatMatrix(&hScoresMatrix);
+      SQ_ClearVectorData(&hPredictedPredictiveComponents);
+
+      SQ_VectorData hPredictedYs = NULL;
+      SQ_FloatMatrix hPredictedYsMatrix = NULL;
+      SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+      SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+      SQ_GetNumColumnsInFloatMatrix(hPredictedYsMatrix, &numColumns);
+      for(int iYVar=1;iYVar<=numColumns;iYVar++){
+	SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, 1, iYVar, &fValue);
+	result.fYValues.push_back(fValue);
+      }
+      SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+      SQ_ClearVectorData(&hPredictedYs);
+
+      SQ_ClearPrediction(&hPredictionHandle);
+      result.bOk = true;
+    }
+
+    predictTimer.busy += std::chrono::steady_clock::now() - start;
+    predictTimer.items++;
+    outputQueue.Push(std::move(result));
+  }
+
+  PredictionResult endOfStream;
+  endOfStream.bEndOfStream = true;
+  outputQueue.PushEndOfStream(std::move(endOfStream));
+
+  parserThread.join();
+  writerThread.join();
+  auto wallTime = std::chrono::steady_clock::now() - wallStart;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PRINT PIPELINE METRICS
+  ////////////////////////////////////////////////////////////////////////
+
+  // Metrics go to stderr so they do not mix with the predictions on stdout
+  auto ms = [](std::chrono::steady_clock::duration d){
+    return std::chrono::duration<double, std::milli>(d).count();
+  };
+  std::cerr << "Parser stage:  " << parserTimer.items << " rows, busy " << ms(parserTimer.busy) << " ms" << std::endl;
+  std::cerr << "SIMCA-Q stage: " << predictTimer.items << " rows, busy " << ms(predictTimer.busy) << " ms" << std::endl;
+  std::cerr << "Writer stage:  " << writerTimer.items << " rows, busy " << ms(writerTimer.busy) << " ms" << std::endl;
+  std::cerr << "Wall time:     " << ms(wallTime) << " ms" << std::endl;
+  inputQueue.PrintMetrics("parser -> SIMCA-Q");
+  outputQueue.PrintMetrics("SIMCA-Q -> writer");
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES AND CLOSE PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
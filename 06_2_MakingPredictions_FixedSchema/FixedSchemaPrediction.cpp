@@ -0,0 +1,170 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+#include "ModelSchema.h" // generated by SchemaGenerator
+
+////////////////////////////////////////////////////////////////////////
+////////////// FUNCTION FOR READING INPUT DATA
+//////////////////////////////////////////////////////////////////////////
+
+// The column layout is fixed by ModelSchema.h, so the first row with the
+// variable names is skipped and the values are read by position only
+bool ReadInputRows(std::string fileName, std::vector<ModelSchema::InputRow>& inputRows)
+{
+  std::ifstream file(fileName);
+  std::string line;
+  if(!std::getline(file, line))
+    return false;
+
+  while(std::getline(file, line)){
+    if(line.empty())
+      continue;
+    ModelSchema::InputRow row;
+    const char* p = line.c_str();
+    for(int iColumn=0;iColumn<ModelSchema::kNumInputColumns;iColumn++){
+      char* end;
+      row[iColumn] = std::strtof(p, &end);
+      if(end == p)
+	return false;
+      p = (*end == ',') ? end + 1 : end;
+    }
+    inputRows.push_back(row);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=3)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file and 2) the name of an input file\n";
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  // The model name is part of the generated schema
+  SQ_Model hModel = FindFittedModel(hProject, ModelSchema::kModelName);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << ModelSchema::kModelName << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// VERIFY THE MODEL AGAINST THE GENERATED SCHEMA
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+
+  // Checked once, when the model is opened. This is the only per-name work
+  // left; no dictionary is built and the rows are bound by position only.
+  bool bMatchesModel = ModelSchema::MatchesModel(hPredictionVariables);
+  SQ_ClearVariableVector(&hPredictionVariables);
+  if(!bMatchesModel)
+    {
+      std::cout << "The variables of model " << ModelSchema::kModelName
+		<< " do not match ModelSchema.h. Run SchemaGenerator again." << std::endl;
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// POPULATE SQ_PREPAREPREDICTION WITH INPUT DATA
+  ////////////////////////////////////////////////////////////////////////
+
+  std::vector<ModelSchema::InputRow> inputRows;
+  if(!ReadInputRows(argv[2], inputRows) || inputRows.empty())
+    {
+      std::cout << "Could not read " << ModelSchema::kNumInputColumns << " values per row from " << argv[2] << std::endl;
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  int numRows = (int)inputRows.size();
+  for(int iObs=1;iObs<=numRows;iObs++){
+    ModelSchema::BindInputRow(hPreparePrediction, iObs, inputRows[iObs-1]);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE ALL PREDICTED Y QUANTITIES
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Prediction hPredictionHandle = NULL;
+  SQ_GetPrediction(hPreparePrediction, &hPredictionHandle);
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  SQ_VectorData hPredictedYs = NULL;
+  SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+
+  SQ_FloatMatrix hPredictedYsMatrix = NULL;
+  SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+
+  int numYVariables;
+  SQ_GetNumColumnsInFloatMatrix(hPredictedYsMatrix, &numYVariables);
+
+  float fYValue;
+  for(int iObs=1; iObs<=numRows;iObs++){
+    for(int iYVar=1;iYVar<=numYVariables;iYVar++){
+      SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, iObs, iYVar, &fYValue);
+      std::cout << "Y variable #" << iYVar << " for observation #" << iObs << ": " << fYValue << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+  hPredictedYsMatrix = NULL;
+  SQ_ClearVectorData(&hPredictedYs);
+  hPredictedYs = NULL;
+  SQ_ClearPrediction(&hPredictionHandle);
+  hPredictionHandle = NULL;
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
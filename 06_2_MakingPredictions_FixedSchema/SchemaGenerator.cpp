@@ -0,0 +1,255 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// SCHEMA HASH
+//////////////////////////////////////////////////////////////////////////
+
+// 64-bit FNV-1a over the variable names in prediction-set order, each name
+// terminated by a newline. The generated MatchesModel() repeats this loop
+// inline, so any change here has to be made in the emitted code below too.
+uint64_t SchemaHash(const std::vector<std::string>& variableNames)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for(const auto& name : variableNames){
+    for(unsigned char c : name){
+      hash ^= c;
+      hash *= 1099511628211ull;
+    }
+    hash ^= '\n';
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// FUNCTION FOR READING THE INPUT COLUMN LAYOUT
+//////////////////////////////////////////////////////////////////////////
+
+// Only the first row of the file, i.e. the variable names, is used.
+// Windows line endings and a trailing comma (as in sampleSpectrum.csv)
+// do not add an extra column.
+bool ReadInputLayout(std::string fileName, std::vector<std::string>& inputVariables)
+{
+  std::ifstream file(fileName);
+  std::string line, word;
+  if(!std::getline(file, line))
+    return false;
+  if(!line.empty() && line.back() == '\r')
+    line.pop_back();
+  std::stringstream s(line);
+  while (std::getline(s, word, ',')) {
+    inputVariables.push_back(word);
+  }
+  return !inputVariables.empty();
+}
+
+// Escape a variable name so that it can be written as a C++ string literal.
+// Control characters are written as three-digit octal escapes, which, unlike
+// hex escapes, never swallow the characters that follow.
+std::string Quote(const std::string& text)
+{
+  std::string quoted = "\"";
+  for(unsigned char c : text){
+    if(c == '"' || c == '\\'){
+      quoted += '\\';
+      quoted += char(c);
+    }
+    else if(c == '\n')
+      quoted += "\\n";
+    else if(c == '\r')
+      quoted += "\\r";
+    else if(c == '\t')
+      quoted += "\\t";
+    else if(c < 0x20 || c == 0x7f){
+      char szEscape[8];
+      snprintf(szEscape, sizeof(szEscape), "\\%03o", c);
+      quoted += szEscape;
+    }
+    else
+      quoted += char(c);
+  }
+  return quoted + "\"";
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=4 && argc!=5)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of the header to generate\n"
+	       <<"and optionally 4) an input file whose first row defines the input column layout\n";
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE THE VARIABLES FOR PREDICTION
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::vector<std::string> vVariableNames;
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    vVariableNames.push_back(szBuffer);
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// MATCH THE INPUT COLUMN LAYOUT
+  ////////////////////////////////////////////////////////////////////////
+
+  // Without an input file the input columns are expected in prediction-set order
+  std::vector<std::string> inputVariables = vVariableNames;
+  if(argc==5){
+    inputVariables.clear();
+    if(!ReadInputLayout(argv[4], inputVariables))
+      {
+	std::cout << "Could not read the column layout from " << argv[4] << std::endl;
+	return -1;
+      }
+  }
+
+  // (slot, column) pairs for every prediction-set variable found in the input
+  std::vector<std::pair<int,int>> binding;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), vVariableNames[iVar-1]);
+    if(res!=inputVariables.end())
+      binding.emplace_back(iVar, int(res - inputVariables.begin()));
+    else
+      std::cout << "Warning: variable " << vVariableNames[iVar-1] << " is not part of the input layout" << std::endl;
+  }
+  if(binding.empty())
+    {
+      std::cout << "None of the variables for prediction is part of the input layout" << std::endl;
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// WRITE THE HEADER
+  ////////////////////////////////////////////////////////////////////////
+
+  std::ofstream header(argv[3]);
+  if(!header)
+    {
+      std::cout << "Could not open " << argv[3] << " for writing" << std::endl;
+      return -1;
+    }
+
+  header << "// Generated by SchemaGenerator from " << Quote(argv[1]) << ", model " << Quote(argv[2]) << ".\n"
+	 << "// Do not edit. Regenerate whenever the model is refitted.\n"
+	 << "#pragma once\n"
+	 << "#include <array>\n"
+	 << "#include <cstdint>\n"
+	 << "#include \"SIMCAQP.h\"\n\n"
+	 << "namespace ModelSchema\n{\n"
+	 << "  constexpr const char* kModelName = " << Quote(argv[2]) << ";\n\n"
+	 << "  // Variables for prediction, in the order of SQ_GetVariablesForPrediction()\n"
+	 << "  constexpr int kNumVariables = " << numPredSetVariables << ";\n"
+	 << "  constexpr const char* kVariableNames[kNumVariables] = {\n";
+  for(const auto& name : vVariableNames)
+    header << "    " << Quote(name) << ",\n";
+  header << "  };\n\n"
+	 << "  constexpr uint64_t kSchemaHash = " << SchemaHash(vVariableNames) << "ull;\n\n"
+	 << "  // Number of values in one input row\n"
+	 << "  constexpr int kNumInputColumns = " << inputVariables.size() << ";\n"
+	 << "  typedef std::array<float, kNumInputColumns> InputRow;\n\n"
+	 << "  // SQ_SetQuantitativeData() slot and input column (0-based) of every bound variable\n"
+	 << "  struct Slot { int iVar; int iColumn; };\n"
+	 << "  constexpr int kNumBoundVariables = " << binding.size() << ";\n"
+	 << "  constexpr Slot kSlots[kNumBoundVariables] = {\n";
+  for(const auto& [iVar, iColumn] : binding)
+    header << "    {" << iVar << ", " << iColumn << "},\n";
+  header << "  };\n\n"
+	 << "  // True if the model still has the variables of this schema. The number\n"
+	 << "  // of variables is compared first; only if it matches are the names\n"
+	 << "  // retrieved and hashed, in a single pass, the same way as SchemaHash()\n"
+	 << "  // in SchemaGenerator.cpp.\n"
+	 << "  inline bool MatchesModel(SQ_VariableVector hPredictionVariables)\n"
+	 << "  {\n"
+	 << "    char szVariableName[256];\n"
+	 << "    int numPredSetVariables;\n"
+	 << "    SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);\n"
+	 << "    if(numPredSetVariables != kNumVariables)\n"
+	 << "      return false;\n"
+	 << "    uint64_t hash = 14695981039346656037ull;\n"
+	 << "    SQ_Variable hVariable = NULL;\n"
+	 << "    for(int iVar=1;iVar<=numPredSetVariables;iVar++){\n"
+	 << "      SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);\n"
+	 << "      SQ_GetVariableName(hVariable, 1, szVariableName, sizeof(szVariableName));\n"
+	 << "      for(const char* c = szVariableName; *c; c++){\n"
+	 << "        hash ^= (unsigned char)*c;\n"
+	 << "        hash *= 1099511628211ull;\n"
+	 << "      }\n"
+	 << "      hash ^= '\\n';\n"
+	 << "      hash *= 1099511628211ull;\n"
+	 << "    }\n"
+	 << "    return hash == kSchemaHash;\n"
+	 << "  }\n\n"
+	 << "  // Copy one input row straight into the SQ_PreparePrediction slots\n"
+	 << "  inline void BindInputRow(SQ_PreparePrediction hPreparePrediction, int iObs, const InputRow& row)\n"
+	 << "  {\n"
+	 << "    for(const Slot& slot : kSlots)\n"
+	 << "      SQ_SetQuantitativeData(hPreparePrediction, iObs, slot.iVar, row[slot.iColumn]);\n"
+	 << "  }\n"
+	 << "}\n";
+
+  std::cout << "Wrote " << argv[3] << ": " << numPredSetVariables << " variables, "
+	    << binding.size() << " bound to " << inputVariables.size() << " input columns" << std::endl;
+
+  return 0;
+}
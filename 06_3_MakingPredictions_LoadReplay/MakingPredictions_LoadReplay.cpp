@@ -0,0 +1,294 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+typedef std::chrono::steady_clock Clock;
+
+////////////////////////////////////////////////////////////////////////
+////////////// PREDICTION BACKENDS
+//////////////////////////////////////////////////////////////////////////
+
+// One backend instance is created per worker thread, so implementations
+// never share state between threads
+class PredictionBackend
+{
+public:
+  virtual ~PredictionBackend() {}
+  virtual bool Predict(const std::vector<float>& fQuantitativeData, std::vector<float>& fYValues) = 0;
+};
+
+// Stands in for SIMCA-Q when sizing the harness itself or when no license
+// is available: every prediction keeps the CPU busy for a fixed service time
+class StubBackend : public PredictionBackend
+{
+public:
+  explicit StubBackend(int serviceMicroseconds) : m_serviceTime(std::chrono::microseconds(serviceMicroseconds)) {}
+
+  bool Predict(const std::vector<float>& fQuantitativeData, std::vector<float>& fYValues) override
+  {
+    auto end = Clock::now() + m_serviceTime;
+    float sum = 0;
+    for(float value : fQuantitativeData)
+      sum += value;
+    while(Clock::now() < end)
+      ;
+    fYValues.assign(1, sum);
+    return true;
+  }
+
+private:
+  Clock::duration m_serviceTime;
+};
+
+// The real prediction path, as in MakingPredictions_Introduction.cpp. Each
+// instance opens its own copy of the project so that no SIMCA-Q handle is
+// ever used from two threads.
+class SimcaQBackend : public PredictionBackend
+{
+public:
+  SimcaQBackend(const char* szUSPFile, const char* szModelName, const std::vector<std::string>& inputVariables)
+  {
+    char szBuffer[256];
+    if(SQ_OpenProject(szUSPFile, NULL, &m_hProject) != SQ_E_OK)
+      return;
+
+    m_hModel = FindFittedModel(m_hProject, szModelName);
+    if (m_hModel == NULL)
+      return;
+
+    SQ_GetNumberOfPredictiveComponents(m_hModel, &m_numPredictiveScores);
+    SQ_GetPreparePrediction(m_hModel, &m_hPreparePrediction);
+
+    // Match the corpus columns against the variables for prediction once
+    SQ_VariableVector hPredictionVariables = NULL;
+    SQ_GetVariablesForPrediction(m_hPreparePrediction, &hPredictionVariables);
+    int numPredSetVariables;
+    SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+    SQ_Variable hVariable = NULL;
+    for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+      SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+      SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+      auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+      if(res!=inputVariables.end())
+	m_binding.emplace_back(iVar, int(res - inputVariables.begin()));
+    }
+    SQ_ClearVariableVector(&hPredictionVariables);
+    m_numRequiredValues = RequiredValues(m_binding);
+    m_bReady = true;
+  }
+
+  ~SimcaQBackend()
+  {
+    if(m_hPreparePrediction)
+      SQ_ClearPreparePrediction(&m_hPreparePrediction);
+    if(m_hProject)
+      SQ_CloseProject(&m_hProject);
+  }
+
+  bool IsReady() const { return m_bReady; }
+
+  bool Predict(const std::vector<float>& fQuantitativeData, std::vector<float>& fYValues) override
+  {
+    // The handle is reused for every request, so a short row would be
+    // predicted with values left over from the previous one
+    if(fQuantitativeData.size() < m_numRequiredValues)
+      return false;
+    for(auto const& [iVar, position] : m_binding)
+      SQ_SetQuantitativeData(m_hPreparePrediction, 1, iVar, fQuantitativeData[position]);
+
+    SQ_Prediction hPredictionHandle = NULL;
+    if(SQ_GetPrediction(m_hPreparePrediction, &hPredictionHandle) != SQ_E_OK)
+      return false;
+
+    SQ_VectorData hPredictedYs = NULL;
+    SQ_FloatMatrix hPredictedYsMatrix = NULL;
+    SQ_GetYPredPS(hPredictionHandle, m_numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+    SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+    int numYVariables;
+    float fYValue;
+    SQ_GetNumColumnsInFloatMatrix(hPredictedYsMatrix, &numYVariables);
+    fYValues.clear();
+    for(int iYVar=1;iYVar<=numYVariables;iYVar++){
+      SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, 1, iYVar, &fYValue);
+      fYValues.push_back(fYValue);
+    }
+    SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+    SQ_ClearVectorData(&hPredictedYs);
+    SQ_ClearPrediction(&hPredictionHandle);
+    return true;
+  }
+
+private:
+  SQ_Project m_hProject = NULL;
+  SQ_Model m_hModel = NULL;
+  SQ_PreparePrediction m_hPreparePrediction = NULL;
+  int m_numPredictiveScores = 0;
+  std::vector<std::pair<int,int>> m_binding;
+  size_t m_numRequiredValues = 0; // one past the last bound position
+  bool m_bReady = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// OPEN-LOOP REPLAY OF ONE CONFIGURATION
+//////////////////////////////////////////////////////////////////////////
+
+struct ReplayResult
+{
+  double throughput = 0; // completed requests per second
+  std::vector<double> latencies; // microseconds, sorted
+  size_t failures = 0;
+};
+
+double Percentile(const std::vector<double>& sorted, double p)
+{
+  if(sorted.empty())
+    return 0;
+  size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// Request i is due at start + i / rate, whether or not earlier requests
+// have completed. Latency is measured from that intended start time, so
+// time spent waiting for a free worker is counted instead of hidden
+// (coordinated omission).
+ReplayResult Replay(std::vector<std::unique_ptr<PredictionBackend>>& backends, const std::vector<std::vector<float>>& rows,
+		    double rate, size_t numRequests)
+{
+  ReplayResult result;
+  std::vector<double> latencies(numRequests);
+  std::vector<char> failed(numRequests, 0);
+  std::atomic<size_t> nextRequest{0};
+  auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+  auto start = Clock::now() + std::chrono::milliseconds(10);
+
+  auto worker = [&](PredictionBackend* backend){
+    std::vector<float> fYValues;
+    while(true){
+      size_t iRequest = nextRequest.fetch_add(1);
+      if(iRequest >= numRequests)
+	break;
+      auto intended = start + interval * (long long)iRequest;
+      std::this_thread::sleep_until(intended);
+      if(!backend->Predict(rows[iRequest % rows.size()], fYValues))
+	failed[iRequest] = 1;
+      latencies[iRequest] = std::chrono::duration<double, std::micro>(Clock::now() - intended).count();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for(auto& backend : backends)
+    workers.emplace_back(worker, backend.get());
+  for(auto& thread : workers)
+    thread.join();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  for(size_t i = 0; i < numRequests; i++){
+    if(failed[i])
+      result.failures++;
+    else
+      result.latencies.push_back(latencies[i]);
+  }
+  std::sort(result.latencies.begin(), result.latencies.end());
+  result.throughput = result.latencies.size() / elapsed;
+  return result;
+}
+
+std::vector<double> ParseList(const char* text)
+{
+  std::vector<double> values;
+  std::stringstream s(text);
+  std::string word;
+  while (std::getline(s, word, ','))
+    values.push_back(std::atof(word.c_str()));
+  return values;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  bool bStub = argc==7 && strcmp(argv[5],"stub")==0;
+  bool bSimcaQ = argc==8 && strcmp(argv[5],"simcaq")==0;
+  if(!bStub && !bSimcaQ)
+    {
+      std::cout<<"\nYou need to pass 1) a corpus file, 2) a comma-separated list of request rates (per second),\n"
+	       <<"3) a comma-separated list of concurrencies, 4) the number of requests per configuration and 5) a backend:\n"
+	       <<"   stub <service time in microseconds>\n"
+	       <<"   simcaq <SIMCA file> <model name>\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[1], inputVariables, rows))
+    {
+      std::cout << "Could not read any request from " << argv[1] << std::endl;
+      return -1;
+    }
+
+  std::vector<double> rates = ParseList(argv[2]);
+  std::vector<double> concurrencies = ParseList(argv[3]);
+  size_t numRequests = (size_t)std::atol(argv[4]);
+  if(numRequests == 0)
+    {
+      std::cout << "The number of requests must be a positive integer" << std::endl;
+      return -1;
+    }
+
+  std::cout << std::setw(10) << "rate/s" << std::setw(8) << "conc" << std::setw(12) << "achieved/s"
+	    << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "p999 us"
+	    << std::setw(12) << "max us" << std::setw(10) << "failed" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+
+  for(double concurrency : concurrencies){
+    // Backends are created once per concurrency level, outside the timed
+    // replay, so opening projects does not show up as request latency
+    std::vector<std::unique_ptr<PredictionBackend>> backends;
+    for(int i = 0; i < (int)concurrency; i++){
+      if(bStub){
+	backends.emplace_back(new StubBackend(std::atoi(argv[6])));
+      }
+      else{
+	SimcaQBackend* backend = new SimcaQBackend(argv[6], argv[7], inputVariables);
+	backends.emplace_back(backend);
+	if(!backend->IsReady())
+	  {
+	    std::cout << "Could not open a fitted model named " << argv[7] << " in " << argv[6] << std::endl;
+	    return -1;
+	  }
+      }
+    }
+    if(backends.empty())
+      continue;
+
+    for(double rate : rates){
+      if(rate <= 0)
+	continue;
+      ReplayResult result = Replay(backends, rows, rate, numRequests);
+      std::cout << std::setw(10) << rate << std::setw(8) << backends.size()
+		<< std::setw(12) << result.throughput
+		<< std::setw(12) << Percentile(result.latencies, 0.50)
+		<< std::setw(12) << Percentile(result.latencies, 0.99)
+		<< std::setw(12) << Percentile(result.latencies, 0.999)
+		<< std::setw(12) << (result.latencies.empty() ? 0.0 : result.latencies.back())
+		<< std::setw(10) << result.failures << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,321 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// INPUT DATA
+//////////////////////////////////////////////////////////////////////////
+
+// Parsed once and shared, read-only, by all models and worker threads.
+// Same layout as sampleSpectrum.csv: a first row with the variable names
+// followed by one or more rows of values (one observation per row).
+struct ParsedInput
+{
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// PER-MODEL RESULTS
+//////////////////////////////////////////////////////////////////////////
+
+struct ModelResult
+{
+  bool bOk = false;
+  std::string error;
+  std::string modelName;
+  std::vector<std::string> columnNames; // score names followed by Y names
+  std::vector<std::vector<float>> values; // one row per observation
+  int numShortRows = 0; // observations that lack a value for a bound variable
+};
+
+// Copy names and values of a SQ_VectorData into a ModelResult and clear it.
+// Returns false if it does not hold one row per input observation, as the
+// merged output would then no longer line up with its header.
+bool AppendVectorData(SQ_VectorData& hVectorData, ModelResult& result)
+{
+  char szBuffer[256];
+  SQ_StringVector hColumnNames = NULL;
+  int numColumns;
+  SQ_GetColumnNames(hVectorData, &hColumnNames);
+  SQ_GetNumStringsInVector(hColumnNames, &numColumns);
+  for(int iCol=1;iCol<=numColumns;iCol++){
+    SQ_GetStringFromVector(hColumnNames, iCol, szBuffer, sizeof(szBuffer));
+    result.columnNames.push_back(szBuffer);
+  }
+  SQ_ClearStringVector(&hColumnNames);
+
+  SQ_FloatMatrix hMatrix = NULL;
+  int numRows;
+  float fValue;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  SQ_GetNumRowsInFloatMatrix(hMatrix, &numRows);
+  bool bAllRows = numRows == (int)result.values.size();
+  for(int iObs=1;bAllRows && iObs<=numRows;iObs++){
+    for(int iCol=1;iCol<=numColumns;iCol++){
+      SQ_GetDataFromFloatMatrix(hMatrix, iObs, iCol, &fValue);
+      result.values[iObs-1].push_back(fValue);
+    }
+  }
+  SQ_ClearFloatMatrix(&hMatrix);
+  SQ_ClearVectorData(&hVectorData);
+  return bAllRows;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// PREDICT ONE MODEL
+//////////////////////////////////////////////////////////////////////////
+
+// Builds the binding for one model from the shared input, predicts all
+// observations in a single SQ_GetPrediction() call and copies the scores
+// and, when the model has any, the predicted Y values
+void PredictModel(SQ_Model hModel, const ParsedInput& input, ModelResult& result)
+{
+  char szBuffer[256];
+  result.values.assign(input.rows.size(), std::vector<float>());
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  if(SQ_GetPreparePrediction(hModel, &hPreparePrediction) != SQ_E_OK){
+    result.error = "could not prepare the prediction";
+    return;
+  }
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::map<std::string, int> DataLookup;
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    DataLookup[szBuffer] = iVar;
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  // A row that is too short keeps the missing value SIMCA-Q starts with
+  // for the variables it lacks; such rows are counted so they can be reported
+  std::vector<bool> bShortRow(input.rows.size(), false);
+  for (auto const& [key, val] : DataLookup){
+    auto res = std::find(input.inputVariables.begin(), input.inputVariables.end(), key);
+    if(res!=input.inputVariables.end()){
+      size_t position = res - input.inputVariables.begin();
+      for(size_t iObs=0;iObs<input.rows.size();iObs++){
+	if(position < input.rows[iObs].size())
+	  SQ_SetQuantitativeData(hPreparePrediction, int(iObs + 1), val, input.rows[iObs][position]);
+	else
+	  bShortRow[iObs] = true;
+      }
+    }
+  }
+  result.numShortRows = (int)std::count(bShortRow.begin(), bShortRow.end(), true);
+
+  SQ_Prediction hPredictionHandle = NULL;
+  if(SQ_GetPrediction(hPreparePrediction, &hPredictionHandle) == SQ_E_OK){
+    SQ_VectorData hPredictedPredictiveComponents = NULL;
+    if(SQ_GetTPS(hPredictionHandle, NULL, &hPredictedPredictiveComponents) == SQ_E_OK)
+      result.bOk = AppendVectorData(hPredictedPredictiveComponents, result);
+
+    // Models without Y variables, e.g. class models, only deliver scores
+    int numPredictiveScores;
+    SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+    SQ_VectorData hPredictedYs = NULL;
+    if(result.bOk && SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True,
+				   NULL, &hPredictedYs) == SQ_E_OK)
+      result.bOk = AppendVectorData(hPredictedYs, result);
+
+    if(!result.bOk)
+      result.error = "SIMCA-Q did not return one row per observation";
+    SQ_ClearPrediction(&hPredictionHandle);
+  }
+  else{
+    result.error = "the prediction failed";
+  }
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// WORKER: A SUBSET OF THE MODELS ON ITS OWN PROJECT COPY
+//////////////////////////////////////////////////////////////////////////
+
+// Each worker only writes to the ModelResult slots of its own models
+void PredictModels(SQ_Project hProject, const std::vector<int>& modelNumbers, const ParsedInput& input,
+		   std::vector<ModelResult>& results, const std::vector<int>& resultSlots)
+{
+  for(size_t i = 0; i < modelNumbers.size(); i++){
+    SQ_Model hModel = NULL;
+    if(SQ_GetModel(hProject, modelNumbers[i], &hModel) == SQ_E_OK)
+      PredictModel(hModel, input, results[resultSlots[i]]);
+    else
+      results[resultSlots[i]].error = "could not load the model";
+  }
+}
+
+void PredictModelsOnCopy(const char* szUSPFile, const std::vector<int>& modelNumbers, const ParsedInput& input,
+			 std::vector<ModelResult>& results, const std::vector<int>& resultSlots)
+{
+  SQ_Project hProject = NULL;
+  if(SQ_OpenProject(szUSPFile, NULL, &hProject) != SQ_E_OK){
+    for(int iSlot : resultSlots)
+      results[iSlot].error = "the worker could not open its copy of the project";
+    return;
+  }
+  PredictModels(hProject, modelNumbers, input, results, resultSlots);
+  SQ_CloseProject(&hProject);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=4)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) the name of an input file and 3) the number of worker threads\n"
+	       <<"(1 predicts all models one after another on a single project handle)\n";
+      return -1;
+    }
+
+  int numWorkers = std::atoi(argv[3]);
+  if(numWorkers<1)
+    {
+      std::cout<<"\nThe number of worker threads must be a positive integer\n";
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// GET INPUT DATA FOR PREDICTION (ONCE)
+  ////////////////////////////////////////////////////////////////////////
+
+  ParsedInput input;
+  if(!ReadInputFile(argv[2], input.inputVariables, input.rows))
+    {
+      std::cout << "Could not read any observation from " << argv[2] << std::endl;
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND FIND ALL FITTED MODELS
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  // The names are read here, so that a model whose worker fails can still
+  // be reported by name
+  char szBuffer[256];
+  int numModels;
+  SQ_GetNumberOfModels(hProject, &numModels);
+  std::vector<int> fittedModelNumbers;
+  std::vector<std::string> fittedModelNames;
+  for(int iModelIndex=1;iModelIndex<=numModels;iModelIndex++){
+    int modelNumber;
+    SQ_Model hModel = NULL;
+    SQ_Bool bIsFitted;
+    SQ_GetModelNumberFromIndex(hProject, iModelIndex, &modelNumber);
+    if(SQ_GetModel(hProject, modelNumber, &hModel) == SQ_E_OK &&
+       SQ_IsModelFitted(hModel, &bIsFitted) == SQ_E_OK && bIsFitted == SQ_True){
+      SQ_GetModelName(hModel, szBuffer, sizeof(szBuffer));
+      fittedModelNumbers.push_back(modelNumber);
+      fittedModelNames.push_back(szBuffer);
+    }
+  }
+
+  if(fittedModelNumbers.empty())
+    {
+      std::cout << "The project does not contain any fitted model" << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT WITH ALL MODELS
+  ////////////////////////////////////////////////////////////////////////
+
+  std::vector<ModelResult> results(fittedModelNumbers.size());
+  for(size_t i = 0; i < results.size(); i++)
+    results[i].modelName = fittedModelNames[i];
+  numWorkers = std::min(numWorkers, (int)fittedModelNumbers.size());
+
+  if(numWorkers == 1){
+    std::vector<int> slots(fittedModelNumbers.size());
+    for(size_t i = 0; i < slots.size(); i++)
+      slots[i] = (int)i;
+    PredictModels(hProject, fittedModelNumbers, input, results, slots);
+  }
+  else{
+    // Models are dealt round-robin to the workers
+    std::vector<std::vector<int>> workerModels(numWorkers), workerSlots(numWorkers);
+    for(size_t i = 0; i < fittedModelNumbers.size(); i++){
+      workerModels[i % numWorkers].push_back(fittedModelNumbers[i]);
+      workerSlots[i % numWorkers].push_back((int)i);
+    }
+    std::vector<std::thread> workers;
+    for(int iWorker = 0; iWorker < numWorkers; iWorker++)
+      workers.emplace_back(PredictModelsOnCopy, szUSPFile, std::cref(workerModels[iWorker]), std::cref(input),
+			   std::ref(results), std::cref(workerSlots[iWorker]));
+    for(auto& worker : workers)
+      worker.join();
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PRINT ONE MERGED RECORD PER OBSERVATION
+  ////////////////////////////////////////////////////////////////////////
+
+  std::cout << "Observation";
+  for(const auto& result : results){
+    if(!result.bOk){
+      std::cerr << "Model " << result.modelName << " left out: "
+		<< (result.error.empty() ? "the prediction failed" : result.error) << std::endl;
+      continue;
+    }
+    if(result.numShortRows > 0)
+      std::cerr << "Model " << result.modelName << ": " << result.numShortRows
+		<< " observations are too short for its variables and were predicted with those values missing" << std::endl;
+    for(const auto& columnName : result.columnNames)
+      std::cout << "," << result.modelName << ":" << columnName;
+  }
+  std::cout << "\n";
+
+  for(size_t iObs = 0; iObs < input.rows.size(); iObs++){
+    std::cout << iObs + 1;
+    for(const auto& result : results){
+      if(!result.bOk)
+	continue;
+      for(float fValue : result.values[iObs])
+	std::cout << "," << fValue;
+    }
+    std::cout << "\n";
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
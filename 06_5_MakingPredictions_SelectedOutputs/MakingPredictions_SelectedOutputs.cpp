@@ -0,0 +1,292 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <sstream>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// OUTPUT SPECIFICATION
+//////////////////////////////////////////////////////////////////////////
+
+// What the caller wants out of the prediction. Empty index lists mean
+// "all", exactly as passing NULL instead of a SQ_IntVector does.
+struct OutputSpec
+{
+  bool bScores = false;
+  std::vector<int> scoreComponents;
+  bool bYValues = false;
+  std::vector<int> yColumns;
+  bool bNames = false;
+};
+
+// Parses specifications like "tps=1;ypred=2,3;names". Items are separated
+// by ';'. "tps" and "ypred" without indices request all components or all
+// Y variables. "names" requests observation, component and Y variable names.
+bool ParseOutputSpec(const std::string& text, OutputSpec& spec)
+{
+  std::stringstream items(text);
+  std::string item;
+  while (std::getline(items, item, ';')) {
+    std::string key = item.substr(0, item.find('='));
+    std::vector<int> indices;
+    if(item.find('=') != std::string::npos){
+      std::stringstream s(item.substr(item.find('=') + 1));
+      std::string word;
+      while (std::getline(s, word, ',')) {
+	int index = std::atoi(word.c_str());
+	if(index < 1)
+	  return false;
+	indices.push_back(index);
+      }
+    }
+
+    if(key == "tps"){
+      spec.bScores = true;
+      spec.scoreComponents = indices;
+    }
+    else if(key == "ypred"){
+      spec.bYValues = true;
+      spec.yColumns = indices;
+    }
+    else if(key == "names" && indices.empty()){
+      spec.bNames = true;
+    }
+    else if(!key.empty()){
+      return false;
+    }
+  }
+  return spec.bScores || spec.bYValues;
+}
+
+// Translates an index list into a SQ_IntVector handle. Returns NULL for an
+// empty list, which makes SIMCA-Q return all columns.
+SQ_IntVector MakeIntVector(const std::vector<int>& indices)
+{
+  if(indices.empty())
+    return NULL;
+  SQ_IntVector hIntVector = NULL;
+  SQ_InitIntVector(&hIntVector, (int)indices.size());
+  for(size_t i = 0; i < indices.size(); i++)
+    SQ_SetDataInIntVector(hIntVector, int(i + 1), indices[i]);
+  return hIntVector;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// PRINT ONE PREDICTED QUANTITY
+//////////////////////////////////////////////////////////////////////////
+
+// Names are only retrieved from SIMCA-Q when the specification asks for them
+void PrintVectorData(SQ_VectorData hVectorData, bool bNames)
+{
+  char szBuffer[256];
+
+  SQ_FloatMatrix hMatrix = NULL;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  int numRows, numColumns;
+  SQ_GetNumRowsInFloatMatrix(hMatrix, &numRows);
+  SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+
+  SQ_StringVector hRowNames = NULL;
+  SQ_StringVector hColumnNames = NULL;
+  if(bNames){
+    SQ_GetRowNames(hVectorData, &hRowNames);
+    SQ_GetColumnNames(hVectorData, &hColumnNames);
+  }
+
+  float fValue;
+  for(int iObs=1;iObs<=numRows;iObs++){
+    for(int iCol=1;iCol<=numColumns;iCol++){
+      SQ_GetDataFromFloatMatrix(hMatrix, iObs, iCol, &fValue);
+      if(bNames){
+	SQ_GetStringFromVector(hColumnNames, iCol, szBuffer, sizeof(szBuffer));
+	std::cout << szBuffer << " for observation ";
+	SQ_GetStringFromVector(hRowNames, iObs, szBuffer, sizeof(szBuffer));
+	std::cout << szBuffer << ": " << fValue << std::endl;
+      }
+      else{
+	std::cout << (iCol > 1 ? "," : "") << fValue;
+      }
+    }
+    if(!bNames)
+      std::cout << "\n";
+  }
+
+  if(bNames){
+    SQ_ClearStringVector(&hRowNames);
+    SQ_ClearStringVector(&hColumnNames);
+  }
+  SQ_ClearFloatMatrix(&hMatrix);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=5)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file\n"
+	       <<"and 4) an output specification, e.g. \"ypred=1\" or \"tps=1,2;ypred;names\"\n";
+      return -1;
+    }
+
+  OutputSpec spec;
+  if(!ParseOutputSpec(argv[4], spec))
+    {
+      std::cout<<"\nInvalid output specification: "<<argv[4]<<"\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cout << "Could not read any observation from " << argv[3] << std::endl;
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREPARE PREDICTION
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::map<std::string, int> DataLookup;
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    DataLookup[szBuffer] = iVar;
+  }
+
+  // Only the first row of the input file is predicted
+  const std::vector<float>& fQuantitativeData = rows[0];
+
+  for (auto const& [key, val] : DataLookup){
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), key);
+    if(res!=inputVariables.end() && size_t(res - inputVariables.begin()) < fQuantitativeData.size()){
+      int position = res - inputVariables.begin();
+      SQ_SetQuantitativeData(hPreparePrediction, 1, val, fQuantitativeData[position]);
+    }
+  }
+
+  SQ_Prediction hPredictionHandle = NULL;
+  eError = SQ_GetPrediction(hPreparePrediction, &hPredictionHandle);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      SQ_ClearVariableVector(&hPredictionVariables);
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE ONLY THE REQUESTED SCORES
+  ////////////////////////////////////////////////////////////////////////
+
+  if(spec.bScores){
+    SQ_IntVector hComponents = MakeIntVector(spec.scoreComponents);
+    SQ_VectorData hPredictedPredictiveComponents = NULL;
+    eError = SQ_GetTPS(hPredictionHandle, hComponents ? &hComponents : NULL, &hPredictedPredictiveComponents);
+    if(hComponents)
+      SQ_ClearIntVector(&hComponents);
+    if(eError == SQ_E_OK){
+      PrintVectorData(hPredictedPredictiveComponents, spec.bNames);
+      SQ_ClearVectorData(&hPredictedPredictiveComponents);
+    }
+    else{
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE ONLY THE REQUESTED Y VARIABLES
+  ////////////////////////////////////////////////////////////////////////
+
+  if(spec.bYValues){
+    int numPredictiveScores;
+    SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+    SQ_IntVector hYColumns = MakeIntVector(spec.yColumns);
+    SQ_VectorData hPredictedYs = NULL;
+    eError = SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True,
+			   hYColumns ? &hYColumns : NULL, &hPredictedYs);
+    if(hYColumns)
+      SQ_ClearIntVector(&hYColumns);
+    if(eError == SQ_E_OK){
+      PrintVectorData(hPredictedYs, spec.bNames);
+      SQ_ClearVectorData(&hPredictedYs);
+    }
+    else{
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_ClearPrediction(&hPredictionHandle);
+  hPredictionHandle = NULL;
+  SQ_ClearVariableVector(&hPredictionVariables);
+  hPredictionVariables = NULL;
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
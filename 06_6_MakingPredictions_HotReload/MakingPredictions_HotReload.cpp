@@ -0,0 +1,384 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <filesystem>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// ONE LOADED VERSION OF THE PROJECT
+//////////////////////////////////////////////////////////////////////////
+
+// Everything one thread needs to predict with one version of the .usp file.
+// It is opened and test predicted by the thread that loads the version, and
+// then handed over to the one prediction thread that uses and destroys it.
+class ModelVersion
+{
+public:
+  ModelVersion(int iVersion, const char* szUSPFile, const char* szModelName,
+	       const std::vector<std::string>& inputVariables, std::string& error)
+    : m_iVersion(iVersion)
+  {
+    char szBuffer[256];
+    SQ_ErrorCode eError = SQ_OpenProject(szUSPFile, NULL, &m_hProject);
+    if (eError != SQ_E_OK)
+      {
+	SQ_GetErrorDescription(eError, szBuffer, sizeof(szBuffer));
+	error = szBuffer;
+	return;
+      }
+
+    m_hModel = FindFittedModel(m_hProject, szModelName);
+    if (m_hModel == NULL)
+      {
+	error = std::string("no fitted model named ") + szModelName;
+	return;
+      }
+
+    SQ_GetNumberOfPredictiveComponents(m_hModel, &m_numPredictiveScores);
+    SQ_GetPreparePrediction(m_hModel, &m_hPreparePrediction);
+
+    // Rebuild the variable binding, since the new model may expect other
+    // variables or another order
+    SQ_VariableVector hPredictionVariables = NULL;
+    SQ_GetVariablesForPrediction(m_hPreparePrediction, &hPredictionVariables);
+    int numPredSetVariables;
+    SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+    SQ_Variable hVariable = NULL;
+    for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+      SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+      SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+      auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+      if(res==inputVariables.end())
+	{
+	  error = std::string("variable ") + szBuffer + " is not part of the input";
+	  break;
+	}
+      m_binding.emplace_back(iVar, int(res - inputVariables.begin()));
+    }
+    SQ_ClearVariableVector(&hPredictionVariables);
+
+    m_bValid = error.empty();
+  }
+
+  ~ModelVersion()
+  {
+    if(m_hPreparePrediction)
+      SQ_ClearPreparePrediction(&m_hPreparePrediction);
+    if(m_hProject)
+      SQ_CloseProject(&m_hProject);
+  }
+
+  bool IsValid() const { return m_bValid; }
+  int Version() const { return m_iVersion; }
+
+  bool Predict(const std::vector<float>& fQuantitativeData, std::vector<float>& fYValues)
+  {
+    for(auto const& [iVar, position] : m_binding){
+      if(position < (int)fQuantitativeData.size())
+	SQ_SetQuantitativeData(m_hPreparePrediction, 1, iVar, fQuantitativeData[position]);
+    }
+
+    SQ_Prediction hPredictionHandle = NULL;
+    if(SQ_GetPrediction(m_hPreparePrediction, &hPredictionHandle) != SQ_E_OK)
+      return false;
+
+    SQ_VectorData hPredictedYs = NULL;
+    SQ_FloatMatrix hPredictedYsMatrix = NULL;
+    SQ_GetYPredPS(hPredictionHandle, m_numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+    SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+    int numYVariables;
+    float fYValue;
+    SQ_GetNumColumnsInFloatMatrix(hPredictedYsMatrix, &numYVariables);
+    fYValues.clear();
+    for(int iYVar=1;iYVar<=numYVariables;iYVar++){
+      SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, 1, iYVar, &fYValue);
+      fYValues.push_back(fYValue);
+    }
+    SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+    SQ_ClearVectorData(&hPredictedYs);
+    SQ_ClearPrediction(&hPredictionHandle);
+    return true;
+  }
+
+private:
+  int m_iVersion;
+  SQ_Project m_hProject = NULL;
+  SQ_Model m_hModel = NULL;
+  SQ_PreparePrediction m_hPreparePrediction = NULL;
+  int m_numPredictiveScores = 0;
+  std::vector<std::pair<int,int>> m_binding;
+  bool m_bValid = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// ONE ACCEPTED VERSION OF THE FILE
+//////////////////////////////////////////////////////////////////////////
+
+// A private copy of an accepted .usp file, so that every thread predicts
+// with the same version even if the original is overwritten again in the
+// meantime, and one ModelVersion on that copy per prediction thread. The
+// versions are opened before the snapshot is published, so a thread that
+// switches only has to take its own. The copy is removed when the last
+// thread has let go of the snapshot.
+class ProjectSnapshot
+{
+public:
+  ProjectSnapshot(int iVersion, const char* szUSPFile, std::string& error)
+    : m_iVersion(iVersion)
+  {
+    namespace fs = std::filesystem;
+    fs::path path(szUSPFile);
+    path.replace_filename(path.stem().string() + ".v" + std::to_string(iVersion) + path.extension().string());
+    std::error_code ec;
+    if(!fs::copy_file(szUSPFile, path, fs::copy_options::overwrite_existing, ec))
+      {
+	error = "could not copy it to " + path.string() + ": " + ec.message();
+	return;
+      }
+    m_path = path.string();
+  }
+
+  ~ProjectSnapshot()
+  {
+    // Versions that no thread has taken are closed before the file goes
+    m_versions.clear();
+    if(m_path.empty())
+      return;
+    std::error_code ec;
+    std::filesystem::remove(m_path, ec);
+    if(m_bPublished)
+      std::cout << "Version " << m_iVersion << " drained and closed" << std::endl;
+  }
+
+  // Opens one ModelVersion per prediction thread on the copy and makes a
+  // test prediction with each of them, on the calling thread
+  bool OpenVersions(int numThreads, const char* szModelName, const std::vector<std::string>& inputVariables,
+		    const std::vector<float>& fQuantitativeData, std::string& error)
+  {
+    std::vector<float> fYValues;
+    for(int iThread=0;iThread<numThreads;iThread++){
+      auto pVersion = std::make_unique<ModelVersion>(m_iVersion, m_path.c_str(), szModelName, inputVariables, error);
+      if(!pVersion->IsValid())
+	return false;
+      if(!pVersion->Predict(fQuantitativeData, fYValues))
+	{
+	  error = "test prediction failed";
+	  return false;
+	}
+      m_versions.push_back(std::move(pVersion));
+    }
+    return true;
+  }
+
+  // Hands the version opened for thread iThread over to that thread. Each
+  // thread only takes its own slot, so no lock is needed.
+  std::unique_ptr<ModelVersion> TakeVersion(int iThread) { return std::move(m_versions[iThread]); }
+
+  void MarkPublished() { m_bPublished = true; }
+  bool IsValid() const { return !m_path.empty(); }
+  int Version() const { return m_iVersion; }
+
+private:
+  int m_iVersion;
+  std::string m_path;
+  std::vector<std::unique_ptr<ModelVersion>> m_versions;
+  bool m_bPublished = false;
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// RCU-STYLE HANDOFF
+//////////////////////////////////////////////////////////////////////////
+
+// Holds the latest accepted version. Threads compare the version number, a
+// single atomic load, before every prediction, and only take the mutex to
+// fetch the snapshot when it has changed. Versions that threads still
+// predict with stay alive until those threads have moved on.
+class CurrentModel
+{
+public:
+  int Version() const { return m_iVersion.load(std::memory_order_acquire); }
+
+  std::shared_ptr<ProjectSnapshot> Acquire() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pSnapshot;
+  }
+
+  void Publish(std::shared_ptr<ProjectSnapshot> pSnapshot)
+  {
+    if(pSnapshot)
+      pSnapshot->MarkPublished();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pSnapshot = std::move(pSnapshot);
+    m_iVersion.store(m_pSnapshot ? m_pSnapshot->Version() : 0, std::memory_order_release);
+  }
+
+private:
+  mutable std::mutex m_mutex;
+  std::shared_ptr<ProjectSnapshot> m_pSnapshot;
+  std::atomic<int> m_iVersion{0};
+};
+
+////////////////////////////////////////////////////////////////////////
+////////////// WATCHER
+//////////////////////////////////////////////////////////////////////////
+
+// Polls the modification time of the .usp file. A change is only acted upon
+// once the file has stayed the same for one whole poll interval, so a file
+// that is still being copied is not opened half-written. The new version is
+// copied, and one copy of the project per prediction thread is opened,
+// validated and test predicted on this thread before it is published.
+void WatchProject(const char* szUSPFile, const char* szModelName, const std::vector<std::string>& inputVariables,
+		  const std::vector<float>& fQuantitativeData, int numThreads, CurrentModel& current,
+		  std::chrono::milliseconds pollInterval, const std::atomic<bool>& bStop)
+{
+  namespace fs = std::filesystem;
+  std::error_code ec;
+  auto loadedTime = fs::last_write_time(szUSPFile, ec);
+  auto pendingTime = loadedTime;
+  int iVersion = current.Version();
+
+  while(!bStop){
+    std::this_thread::sleep_for(pollInterval);
+    auto modifiedTime = fs::last_write_time(szUSPFile, ec);
+    if(ec || modifiedTime == loadedTime)
+      continue;
+    if(modifiedTime != pendingTime){
+      // Changed since the last poll: wait until it settles
+      pendingTime = modifiedTime;
+      continue;
+    }
+
+    loadedTime = modifiedTime;
+    std::string error;
+    auto pSnapshot = std::make_shared<ProjectSnapshot>(iVersion + 1, szUSPFile, error);
+    if(pSnapshot->IsValid())
+      pSnapshot->OpenVersions(numThreads, szModelName, inputVariables, fQuantitativeData, error);
+    if(!error.empty())
+      {
+	std::cout << "Ignoring changed " << szUSPFile << ": " << error << std::endl;
+	continue;
+      }
+
+    iVersion++;
+    current.Publish(pSnapshot);
+    std::cout << "Published version " << iVersion << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=6)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file,\n"
+	       <<"4) the number of prediction threads and 5) for how many seconds to run\n";
+      return -1;
+    }
+
+  const char * szUSPFile = argv[1];
+  const char * szModelName = argv[2];
+  int numThreads = std::atoi(argv[4]);
+  int numSeconds = std::atoi(argv[5]);
+  if(numThreads<1 || numSeconds<1)
+    {
+      std::cout<<"\nThe number of threads and seconds must be positive integers\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cout<<"\nCould not read any observation from "<<argv[3]<<"\n";
+      return -1;
+    }
+  const std::vector<float>& fQuantitativeData = rows[0];
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD THE FIRST VERSION
+  ////////////////////////////////////////////////////////////////////////
+
+  CurrentModel current;
+  std::string error;
+  auto pFirstSnapshot = std::make_shared<ProjectSnapshot>(1, szUSPFile, error);
+  if(pFirstSnapshot->IsValid())
+    pFirstSnapshot->OpenVersions(numThreads, szModelName, inputVariables, fQuantitativeData, error);
+  if(!error.empty())
+    {
+      std::cout << "Could not load " << szUSPFile << ": " << error << std::endl;
+      return -1;
+    }
+  current.Publish(pFirstSnapshot);
+  pFirstSnapshot.reset();
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT WHILE WATCHING FOR NEW VERSIONS
+  ////////////////////////////////////////////////////////////////////////
+
+  std::atomic<bool> bStop{false};
+  std::thread watcher(WatchProject, szUSPFile, szModelName, std::cref(inputVariables), std::cref(fQuantitativeData),
+		      numThreads, std::ref(current), std::chrono::milliseconds(500), std::cref(bStop));
+
+  // Number of predictions served by each version
+  std::mutex countsMutex;
+  std::map<int, long> predictionsPerVersion;
+
+  std::vector<std::thread> predictors;
+  for(int iThread=0;iThread<numThreads;iThread++){
+    predictors.emplace_back([&, iThread](){
+      // This thread's own copy of the project. It was opened by the thread
+      // that loaded the version and is only used by this thread from here on.
+      std::shared_ptr<ProjectSnapshot> pSnapshot;
+      std::unique_ptr<ModelVersion> pVersion;
+      int iTakenVersion = 0;
+      std::vector<float> fYValues;
+      std::map<int, long> counts;
+      while(!bStop){
+	// Switch between two predictions. The other threads keep predicting
+	// with the version they have until they switch as well.
+	if(current.Version() != iTakenVersion){
+	  auto pNewSnapshot = current.Acquire();
+	  iTakenVersion = pNewSnapshot->Version();
+	  pVersion = pNewSnapshot->TakeVersion(iThread);
+	  pSnapshot = std::move(pNewSnapshot);
+	}
+	if(pVersion && pVersion->Predict(fQuantitativeData, fYValues))
+	  counts[pVersion->Version()]++;
+      }
+      // Close the project before letting go of its file
+      pVersion.reset();
+      pSnapshot.reset();
+      std::lock_guard<std::mutex> lock(countsMutex);
+      for(auto const& [iVersion, count] : counts)
+	predictionsPerVersion[iVersion] += count;
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(numSeconds));
+  bStop = true;
+  for(auto& predictor : predictors)
+    predictor.join();
+  watcher.join();
+
+  for(auto const& [iVersion, count] : predictionsPerVersion)
+    std::cout << "Version " << iVersion << " served " << count << " predictions" << std::endl;
+
+  // Releasing the last reference removes the copy of the current version
+  current.Publish(nullptr);
+
+  return 0;
+}
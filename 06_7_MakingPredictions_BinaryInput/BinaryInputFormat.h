@@ -0,0 +1,306 @@
+// Compact binary format for prediction input.
+//
+// A stream starts with a schema block naming the variables once, followed by
+// any number of row frames. Integers and IEEE float32 values are stored
+// little-endian, the byte order of every platform SIMCA-Q runs on, and every
+// field is a multiple of 4 bytes, so the values of a memory-mapped file can
+// be used in place.
+//
+//   Schema block
+//     char[4]   magic "SQBI"
+//     uint32    format version (1)
+//     uint32    number of variables N
+//     N times   uint32 name length, name bytes (not terminated)
+//     padding   0 to 3 zero bytes up to a multiple of 4
+//
+//   Row frame
+//     uint32    number of bytes that follow in this frame
+//     uint32    flags; bit 0 set means a missing-value bitmap follows
+//     uint32[(N+31)/32]  missing-value bitmap, only if flag bit 0 is set;
+//                        bit i%32 of word i/32 set means variable i is missing
+//     float32[N] values, in the order of the schema
+//
+// Readers reject schemas with more than kMaxVariables variables or names
+// longer than kMaxNameLength bytes. The names are only stored as their bytes
+// arrive, so a corrupt or hostile header alone does not make a reader
+// allocate much: at most one frame buffer of about 4 MB when reading a pipe.
+//
+// BinaryInputWriter writes this format. BinaryInputReader reads it either by
+// mapping a file into memory or from a pipe such as stdin, and hands out
+// pointers to the values of each frame without converting anything.
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BinaryInput
+{
+  constexpr char kMagic[4] = {'S', 'Q', 'B', 'I'};
+  constexpr uint32_t kVersion = 1;
+  constexpr uint32_t kHasMissingBitmap = 1;
+  constexpr uint32_t kMaxVariables = 1 << 20;
+  constexpr uint32_t kMaxNameLength = 1024;
+  constexpr uint32_t kReservedVariables = 4096; // names reserved up front
+
+  // Result of BinaryInputReader::NextFrame()
+  enum class FrameStatus { Frame, End, Error };
+
+  inline size_t BitmapWords(size_t numVariables) { return (numVariables + 31) / 32; }
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// WRITER
+  //////////////////////////////////////////////////////////////////////////
+
+  class BinaryInputWriter
+  {
+  public:
+    explicit BinaryInputWriter(FILE* pFile) : m_pFile(pFile) {}
+
+    bool WriteSchema(const std::vector<std::string>& variableNames)
+    {
+      m_numVariables = variableNames.size();
+      uint32_t header[2] = { kVersion, (uint32_t)m_numVariables };
+      size_t written = std::fwrite(kMagic, 1, 4, m_pFile) + std::fwrite(header, 1, sizeof(header), m_pFile);
+      size_t expected = 4 + sizeof(header);
+      for(auto const& name : variableNames){
+	uint32_t length = (uint32_t)name.size();
+	written += std::fwrite(&length, 1, 4, m_pFile) + std::fwrite(name.data(), 1, name.size(), m_pFile);
+	expected += 4 + name.size();
+      }
+      const char padding[4] = {0, 0, 0, 0};
+      size_t paddingBytes = (4 - expected % 4) % 4;
+      written += std::fwrite(padding, 1, paddingBytes, m_pFile);
+      return written == expected + paddingBytes;
+    }
+
+    // pMissing may be NULL when no value of the row is missing. Otherwise it
+    // holds one flag per variable, and the values of missing variables are
+    // ignored by readers.
+    bool WriteFrame(const float* pValues, const std::vector<bool>* pMissing = NULL)
+    {
+      if(pMissing && pMissing->size() != m_numVariables)
+	return false;
+
+      bool bAnyMissing = false;
+      if(pMissing){
+	for(bool bMissing : *pMissing)
+	  bAnyMissing = bAnyMissing || bMissing;
+      }
+
+      uint32_t frameHeader[2] = { 4, bAnyMissing ? kHasMissingBitmap : 0 };
+      if(bAnyMissing){
+	m_bitmap.assign(BitmapWords(m_numVariables), 0);
+	for(size_t i = 0; i < m_numVariables; i++){
+	  if((*pMissing)[i])
+	    m_bitmap[i / 32] |= uint32_t(1) << (i % 32);
+	}
+	frameHeader[0] += uint32_t(m_bitmap.size() * 4);
+      }
+      frameHeader[0] += uint32_t(m_numVariables * 4);
+
+      size_t written = std::fwrite(frameHeader, 1, sizeof(frameHeader), m_pFile);
+      size_t expected = sizeof(frameHeader);
+      if(bAnyMissing){
+	written += std::fwrite(m_bitmap.data(), 4, m_bitmap.size(), m_pFile) * 4;
+	expected += m_bitmap.size() * 4;
+      }
+      written += std::fwrite(pValues, 4, m_numVariables, m_pFile) * 4;
+      expected += m_numVariables * 4;
+      return written == expected;
+    }
+
+  private:
+    FILE* m_pFile;
+    size_t m_numVariables = 0;
+    std::vector<uint32_t> m_bitmap;
+  };
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// READER
+  //////////////////////////////////////////////////////////////////////////
+
+  // One row. The pointers stay valid until the next call to NextFrame().
+  struct Frame
+  {
+    const float* pValues = NULL;
+    const uint32_t* pMissingBitmap = NULL; // NULL when no value is missing
+
+    bool IsMissing(size_t iVariable) const
+    {
+      return pMissingBitmap && (pMissingBitmap[iVariable / 32] >> (iVariable % 32) & 1);
+    }
+  };
+
+  class BinaryInputReader
+  {
+  public:
+    BinaryInputReader() = default;
+    BinaryInputReader(const BinaryInputReader&) = delete;
+    BinaryInputReader& operator=(const BinaryInputReader&) = delete;
+
+    ~BinaryInputReader()
+    {
+#if !defined(_WIN32)
+      if(m_pMapping)
+	munmap(m_pMapping, m_mappingSize);
+#endif
+      if(m_pStream && m_pStream != stdin)
+	std::fclose(m_pStream);
+    }
+
+    // Opens a file, or stdin when the name is "-", and reads the schema.
+    // Regular files are mapped into memory where the platform supports it;
+    // anything else is read frame by frame into a reused buffer.
+    bool Open(const std::string& fileName)
+    {
+      if(fileName == "-"){
+#if defined(_WIN32)
+	_setmode(_fileno(stdin), _O_BINARY);
+#endif
+	m_pStream = stdin;
+	return ReadSchema();
+      }
+
+#if !defined(_WIN32)
+      int fd = open(fileName.c_str(), O_RDONLY);
+      if(fd < 0)
+	return false;
+      struct stat info;
+      if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+	void* pMapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(pMapping == MAP_FAILED)
+	  return false;
+	m_pMapping = pMapping;
+	m_mappingSize = (size_t)info.st_size;
+	madvise(m_pMapping, m_mappingSize, MADV_SEQUENTIAL);
+	return ReadSchema();
+      }
+      close(fd);
+#endif
+
+      m_pStream = std::fopen(fileName.c_str(), "rb");
+      return m_pStream && ReadSchema();
+    }
+
+    const std::vector<std::string>& VariableNames() const { return m_variableNames; }
+
+    // End only when the input stops exactly after a frame. A malformed or
+    // truncated frame, or a read error, is an Error.
+    FrameStatus NextFrame(Frame& frame)
+    {
+      if(AtEnd())
+	return FrameStatus::End;
+
+      uint32_t frameHeader[2];
+      if(!Read(frameHeader, sizeof(frameHeader)))
+	return FrameStatus::Error;
+
+      size_t bitmapBytes = (frameHeader[1] & kHasMissingBitmap) ? BitmapWords(m_variableNames.size()) * 4 : 0;
+      size_t valueBytes = m_variableNames.size() * 4;
+      if(frameHeader[0] != 4 + bitmapBytes + valueBytes)
+	return FrameStatus::Error;
+
+      const uint8_t* pPayload = Take(bitmapBytes + valueBytes);
+      if(!pPayload)
+	return FrameStatus::Error;
+      frame.pMissingBitmap = bitmapBytes ? reinterpret_cast<const uint32_t*>(pPayload) : NULL;
+      frame.pValues = reinterpret_cast<const float*>(pPayload + bitmapBytes);
+      return FrameStatus::Frame;
+    }
+
+  private:
+    bool ReadSchema()
+    {
+      char magic[4];
+      uint32_t header[2];
+      if(!Read(magic, 4) || std::memcmp(magic, kMagic, 4) != 0 || !Read(header, sizeof(header)) || header[0] != kVersion)
+	return false;
+
+      // Every name takes at least its 4-byte length
+      if(header[1] > kMaxVariables || header[1] > Remaining() / 4)
+	return false;
+
+      size_t schemaBytes = 4 + sizeof(header);
+      m_variableNames.reserve(std::min(header[1], kReservedVariables));
+      for(uint32_t i = 0; i < header[1]; i++){
+	uint32_t length;
+	if(!Read(&length, 4) || length > kMaxNameLength || length > Remaining())
+	  return false;
+	const uint8_t* pName = Take(length);
+	if(!pName)
+	  return false;
+	m_variableNames.emplace_back(reinterpret_cast<const char*>(pName), length);
+	schemaBytes += 4 + length;
+      }
+      return Take((4 - schemaBytes % 4) % 4) != NULL;
+    }
+
+    // True if no byte of input is left. A read error on a pipe is not the
+    // end; it makes the next Read() fail instead.
+    bool AtEnd()
+    {
+      if(m_pMapping)
+	return m_offset == m_mappingSize;
+      int c = std::fgetc(m_pStream);
+      if(c == EOF)
+	return !std::ferror(m_pStream);
+      std::ungetc(c, m_pStream);
+      return false;
+    }
+
+    // Bytes left in a mapped file. The length of a pipe is not known.
+    size_t Remaining() const
+    {
+      return m_pMapping ? m_mappingSize - m_offset : std::numeric_limits<size_t>::max();
+    }
+
+    // Returns a pointer to the next numBytes of input, either into the
+    // mapping or into the reused buffer, or NULL if the input is too short.
+    // numBytes is bounded by the schema limits checked in ReadSchema().
+    const uint8_t* Take(size_t numBytes)
+    {
+      if(m_pMapping){
+	if(m_mappingSize - m_offset < numBytes)
+	  return NULL;
+	const uint8_t* p = static_cast<const uint8_t*>(m_pMapping) + m_offset;
+	m_offset += numBytes;
+	return p;
+      }
+      // A vector of uint32_t keeps the values 4-byte aligned
+      m_buffer.resize(numBytes / 4 + 1);
+      if(std::fread(m_buffer.data(), 1, numBytes, m_pStream) != numBytes)
+	return NULL;
+      return reinterpret_cast<const uint8_t*>(m_buffer.data());
+    }
+
+    bool Read(void* pDestination, size_t numBytes)
+    {
+      const uint8_t* p = Take(numBytes);
+      if(p)
+	std::memcpy(pDestination, p, numBytes);
+      return p != NULL;
+    }
+
+    std::vector<std::string> m_variableNames;
+    void* m_pMapping = NULL;
+    size_t m_mappingSize = 0;
+    size_t m_offset = 0;
+    FILE* m_pStream = NULL;
+    std::vector<uint32_t> m_buffer;
+  };
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "BinaryInputFormat.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// FUNCTION FOR SPLITTING ONE CSV LINE
+//////////////////////////////////////////////////////////////////////////
+
+// Splits a line at commas, ignoring a trailing carriage return and a
+// trailing comma, as found in sampleSpectrum.csv
+std::vector<std::string> SplitLine(std::string line)
+{
+  if(!line.empty() && line.back() == '\r')
+    line.pop_back();
+  if(!line.empty() && line.back() == ',')
+    line.pop_back();
+
+  std::vector<std::string> words;
+  std::stringstream s(line);
+  std::string word;
+  while (std::getline(s, word, ',')) {
+    words.push_back(word);
+  }
+  return words;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=3)
+    {
+      std::cout<<"\nYou need to pass 1) the name of a CSV input file and 2) the name of the binary file\n"
+	       <<"to write, or - to write to stdout\n";
+      return -1;
+    }
+
+  std::ifstream file(argv[1]);
+  std::string line;
+  if(!std::getline(file, line))
+    {
+      std::cerr << "Could not read the variable names from " << argv[1] << std::endl;
+      return -1;
+    }
+  std::vector<std::string> variableNames = SplitLine(line);
+
+  std::string outputName = argv[2];
+  FILE* pOutput = stdout;
+  if(outputName == "-"){
+#if defined(_WIN32)
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  }
+  else
+    pOutput = std::fopen(argv[2], "wb");
+  if(!pOutput)
+    {
+      std::cerr << "Could not open " << argv[2] << " for writing" << std::endl;
+      return -1;
+    }
+
+  BinaryInput::BinaryInputWriter writer(pOutput);
+  bool bOK = writer.WriteSchema(variableNames);
+
+  // Empty fields, fields that are not numbers and NaN are written as missing
+  std::vector<float> fValues(variableNames.size());
+  std::vector<bool> bMissing(variableNames.size());
+  int numRows = 0;
+  while(bOK && std::getline(file, line)){
+    std::vector<std::string> words = SplitLine(line);
+    if(words.empty())
+      continue;
+    for(size_t i = 0; i < variableNames.size(); i++){
+      const char* p = i < words.size() ? words[i].c_str() : "";
+      char* end;
+      fValues[i] = std::strtof(p, &end);
+      bMissing[i] = end == p || *end != '\0' || std::isnan(fValues[i]);
+      if(bMissing[i])
+	fValues[i] = 0;
+    }
+    bOK = writer.WriteFrame(fValues.data(), &bMissing);
+    numRows++;
+  }
+
+  if(pOutput != stdout)
+    bOK = std::fclose(pOutput) == 0 && bOK;
+  else
+    bOK = std::fflush(pOutput) == 0 && bOK;
+  if(!bOK)
+    {
+      std::cerr << "Could not write " << argv[2] << std::endl;
+      return -1;
+    }
+
+  std::cerr << "Wrote " << variableNames.size() << " variables and " << numRows << " rows" << std::endl;
+  return 0;
+}
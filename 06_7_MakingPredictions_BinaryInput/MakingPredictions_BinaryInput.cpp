@@ -0,0 +1,190 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+#include "BinaryInputFormat.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// PREDICT ONE BATCH OF FRAMES
+//////////////////////////////////////////////////////////////////////////
+
+// Prints the predicted Y values of all observations of the batch, one line
+// per observation
+bool PredictBatch(SQ_PreparePrediction hPreparePrediction, int numPredictiveScores)
+{
+  SQ_Prediction hPredictionHandle = NULL;
+  if(SQ_GetPrediction(hPreparePrediction, &hPredictionHandle) != SQ_E_OK)
+    return false;
+
+  SQ_VectorData hPredictedYs = NULL;
+  SQ_FloatMatrix hPredictedYsMatrix = NULL;
+  SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+  SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+
+  int numObservations, numYVariables;
+  float fYValue;
+  SQ_GetNumRowsInFloatMatrix(hPredictedYsMatrix, &numObservations);
+  SQ_GetNumColumnsInFloatMatrix(hPredictedYsMatrix, &numYVariables);
+  for(int iObs=1;iObs<=numObservations;iObs++){
+    for(int iYVar=1;iYVar<=numYVariables;iYVar++){
+      SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, iObs, iYVar, &fYValue);
+      std::cout << (iYVar > 1 ? "," : "") << fYValue;
+    }
+    std::cout << "\n";
+  }
+
+  SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+  SQ_ClearVectorData(&hPredictedYs);
+  SQ_ClearPrediction(&hPredictionHandle);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=4 && argc!=5)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of a binary input file,\n"
+	       <<"or - to read it from stdin, and optionally 4) the number of rows predicted per batch\n";
+      return -1;
+    }
+
+  int batchSize = argc==5 ? std::atoi(argv[4]) : 100;
+  if(batchSize<1)
+    {
+      std::cout<<"\nThe number of rows per batch must be a positive integer\n";
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// OPEN THE BINARY INPUT
+  ////////////////////////////////////////////////////////////////////////
+
+  BinaryInput::BinaryInputReader reader;
+  if(!reader.Open(argv[3]))
+    {
+      std::cerr << "Could not read a binary input schema from " << argv[3] << std::endl;
+      return -1;
+    }
+  const std::vector<std::string>& inputVariables = reader.VariableNames();
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cerr << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cerr << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// BIND THE SCHEMA TO THE MODEL (ONCE)
+  ////////////////////////////////////////////////////////////////////////
+
+  // The variable names are only in the schema block, so they are matched
+  // against the variables for prediction once for the whole stream
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::vector<std::pair<int, size_t>> binding; // (SIMCA-Q variable, schema position)
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+    if(res!=inputVariables.end())
+      binding.emplace_back(iVar, size_t(res - inputVariables.begin()));
+    else
+      std::cerr << "Variable " << szBuffer << " is not in the input schema and will be missing" << std::endl;
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT THE FRAMES IN BATCHES
+  ////////////////////////////////////////////////////////////////////////
+
+  // Values are copied straight from the frames into the SQ_PreparePrediction
+  // handle. Missing values are not set, so SIMCA-Q treats them as missing; for
+  // this every batch starts from a new SQ_PreparePrediction handle.
+  BinaryInput::Frame frame;
+  BinaryInput::FrameStatus eStatus = BinaryInput::FrameStatus::Frame;
+  int numRows = 0;
+  int iObs = 0;
+  bool bOK = true;
+  while(bOK && (eStatus = reader.NextFrame(frame)) == BinaryInput::FrameStatus::Frame){
+    if(hPreparePrediction == NULL)
+      SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+    iObs++;
+    for(auto const& [iVar, position] : binding){
+      if(!frame.IsMissing(position))
+	SQ_SetQuantitativeData(hPreparePrediction, iObs, iVar, frame.pValues[position]);
+    }
+    numRows++;
+
+    if(iObs == batchSize){
+      bOK = PredictBatch(hPreparePrediction, numPredictiveScores);
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      hPreparePrediction = NULL;
+      iObs = 0;
+    }
+  }
+  // The rows read before a broken frame are still predicted, but the run
+  // fails, since the rest of the input is lost
+  if(bOK && iObs > 0)
+    bOK = PredictBatch(hPreparePrediction, numPredictiveScores);
+  std::cout.flush();
+
+  if(!bOK)
+    std::cerr << "Prediction failed" << std::endl;
+  if(eStatus == BinaryInput::FrameStatus::Error){
+    std::cerr << "Malformed or truncated frame after row " << numRows << std::endl;
+    bOK = false;
+  }
+  std::cerr << "Predicted " << numRows << " rows" << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES, CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  if(hPreparePrediction)
+    SQ_ClearPreparePrediction(&hPreparePrediction);
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return bOK ? 0 : -1;
+}
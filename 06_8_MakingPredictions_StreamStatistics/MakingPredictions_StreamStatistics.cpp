@@ -0,0 +1,253 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+#include "StreamStatistics.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// FUNCTION FOR PARSING THE WINDOW LENGTHS
+//////////////////////////////////////////////////////////////////////////
+
+// Parses a comma separated list of positive integers like "10,100,1000"
+bool ParseWindowLengths(const std::string& text, std::vector<size_t>& windowLengths)
+{
+  std::stringstream s(text);
+  std::string word;
+  while (std::getline(s, word, ',')) {
+    int length = std::atoi(word.c_str());
+    if(length < 1)
+      return false;
+    windowLengths.push_back((size_t)length);
+  }
+  return !windowLengths.empty();
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// COPY ONE PREDICTED QUANTITY INTO THE CHANNEL VALUES
+//////////////////////////////////////////////////////////////////////////
+
+// Appends the values of observation 1 of a SQ_VectorData to fValues and,
+// the first time only, its column names to channelNames
+void AppendObservation(SQ_VectorData hVectorData, std::vector<float>& fValues,
+		       std::vector<std::string>* pChannelNames)
+{
+  char szBuffer[256];
+
+  SQ_FloatMatrix hMatrix = NULL;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  int numColumns;
+  float fValue;
+  SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+  for(int iCol=1;iCol<=numColumns;iCol++){
+    SQ_GetDataFromFloatMatrix(hMatrix, 1, iCol, &fValue);
+    fValues.push_back(fValue);
+  }
+  SQ_ClearFloatMatrix(&hMatrix);
+
+  if(pChannelNames){
+    SQ_StringVector hColumnNames = NULL;
+    SQ_GetColumnNames(hVectorData, &hColumnNames);
+    for(int iCol=1;iCol<=numColumns;iCol++){
+      SQ_GetStringFromVector(hColumnNames, iCol, szBuffer, sizeof(szBuffer));
+      pChannelNames->push_back(szBuffer);
+    }
+    SQ_ClearStringVector(&hColumnNames);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=7)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file,\n"
+	       <<"4) the window lengths in observations, e.g. 10,100,1000, 5) the snapshot interval in\n"
+	       <<"milliseconds and 6) how many times to predict all rows of the input file\n";
+      return -1;
+    }
+
+  std::vector<size_t> windowLengths;
+  int snapshotMilliseconds = std::atoi(argv[5]);
+  int numPasses = std::atoi(argv[6]);
+  if(!ParseWindowLengths(argv[4], windowLengths) || snapshotMilliseconds<1 || numPasses<1)
+    {
+      std::cout<<"\nThe window lengths, the snapshot interval and the number of passes must be positive integers\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cerr << "Could not read any observation from " << argv[3] << std::endl;
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cerr << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cerr << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREPARE PREDICTION
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::vector<std::pair<int, size_t>> binding; // (SIMCA-Q variable, input column)
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+    if(res!=inputVariables.end())
+      binding.emplace_back(iVar, size_t(res - inputVariables.begin()));
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  if(!DropShortRows(rows, RequiredValues(binding)))
+    {
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT THE STREAM AND AGGREGATE THE RESULTS
+  ////////////////////////////////////////////////////////////////////////
+
+  // The aggregator is created after the first prediction, when the names of
+  // the score components and Y variables are known
+  std::unique_ptr<StreamStatistics::StreamAggregator> pAggregator;
+  const std::vector<double> quantiles = {0.05, 0.5, 0.95};
+
+  std::mutex stopMutex;
+  std::condition_variable stopCondition;
+  bool bStop = false;
+  std::thread snapshotThread;
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<float> fValues;
+  long numMismatched = 0; // predictions with another number of channels than the first
+  for(int iPass=0;iPass<numPasses;iPass++){
+    for(auto const& row : rows){
+      for(auto const& [iVar, position] : binding)
+	SQ_SetQuantitativeData(hPreparePrediction, 1, iVar, row[position]);
+
+      SQ_Prediction hPredictionHandle = NULL;
+      if(SQ_GetPrediction(hPreparePrediction, &hPredictionHandle) != SQ_E_OK)
+	continue;
+
+      // Scores of the predictive components, then the predicted Y values
+      std::vector<std::string> channelNames;
+      std::vector<std::string>* pChannelNames = pAggregator ? NULL : &channelNames;
+      fValues.clear();
+      SQ_VectorData hPredictedScores = NULL;
+      if(SQ_GetTPS(hPredictionHandle, NULL, &hPredictedScores) == SQ_E_OK){
+	AppendObservation(hPredictedScores, fValues, pChannelNames);
+	SQ_ClearVectorData(&hPredictedScores);
+      }
+      SQ_VectorData hPredictedYs = NULL;
+      if(SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True,
+		       NULL, &hPredictedYs) == SQ_E_OK){
+	AppendObservation(hPredictedYs, fValues, pChannelNames);
+	SQ_ClearVectorData(&hPredictedYs);
+      }
+      SQ_ClearPrediction(&hPredictionHandle);
+
+      if(!pAggregator){
+	pAggregator.reset(new StreamStatistics::StreamAggregator(channelNames, windowLengths, quantiles));
+	pAggregator->PrintHeader(std::cout);
+
+	// Snapshots are printed by their own thread, independent of how fast
+	// predictions arrive
+	snapshotThread = std::thread([&](){
+	  std::unique_lock<std::mutex> lock(stopMutex);
+	  while(!stopCondition.wait_for(lock, std::chrono::milliseconds(snapshotMilliseconds), [&](){ return bStop; })){
+	    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	    pAggregator->PrintSnapshot(std::cout, elapsed.count());
+	  }
+	});
+      }
+      if(fValues.size() == pAggregator->NumChannels())
+	pAggregator->Add(fValues.data());
+      else
+	numMismatched++;
+    }
+  }
+
+  if(snapshotThread.joinable()){
+    {
+      std::lock_guard<std::mutex> lock(stopMutex);
+      bStop = true;
+    }
+    stopCondition.notify_one();
+    snapshotThread.join();
+
+    // Final snapshot with all observations
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    pAggregator->PrintSnapshot(std::cout, elapsed.count());
+  }
+  else{
+    std::cerr << "No prediction succeeded" << std::endl;
+  }
+  if(numMismatched > 0)
+    std::cerr << "Left out " << numMismatched << " predictions that did not return the "
+	      << pAggregator->NumChannels() << " channels of the first one" << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES, CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+  hPreparePrediction = NULL;
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+// Incremental statistics over a stream of predicted values.
+//
+// Every channel, e.g. one Y variable or one score component, keeps for each
+// requested window length:
+//   - the mean and variance of the last N values (sliding window),
+//   - quantiles of the last N values from a log-bucket sketch,
+//   - an exponentially weighted mean and variance with a span of N values.
+// Adding a value costs O(1) per channel and window, independent of N.
+// Quantiles carry a relative error of at most the sketch accuracy (1%).
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../Common/QuantileSketch.h"
+
+namespace StreamStatistics
+{
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// SLIDING WINDOW AND EWMA
+  //////////////////////////////////////////////////////////////////////////
+
+  // Mean, variance and quantiles of the last N values. The values of the
+  // window are kept in a ring so the oldest one can be taken out of the
+  // running mean, the sum of squared deviations and the sketch.
+  class SlidingWindow
+  {
+  public:
+    explicit SlidingWindow(size_t length) : m_values(length) {}
+
+    void Add(double x)
+    {
+      if(std::isnan(x))
+	return;
+      if(m_count < m_values.size()){
+	// Filling up: Welford's update
+	m_count++;
+	double delta = x - m_mean;
+	m_mean += delta / double(m_count);
+	m_sumSquares += delta * (x - m_mean);
+      }
+      else{
+	// Full: replace the oldest value in one step
+	double oldest = m_values[m_next];
+	double oldMean = m_mean;
+	m_mean += (x - oldest) / double(m_count);
+	m_sumSquares += (x - oldest) * (x - m_mean + oldest - oldMean);
+	m_sketch.Remove(oldest);
+      }
+      m_values[m_next] = x;
+      m_next = (m_next + 1) % m_values.size();
+      m_sketch.Add(x);
+    }
+
+    size_t Length() const { return m_values.size(); }
+    size_t Count() const { return m_count; }
+    double Mean() const { return m_count ? m_mean : NAN; }
+    double Variance() const { return m_count > 1 ? std::max(0.0, m_sumSquares / double(m_count - 1)) : NAN; }
+    double Quantile(double q) const { return m_sketch.Quantile(q); }
+
+  private:
+    std::vector<double> m_values;
+    size_t m_next = 0;
+    size_t m_count = 0;
+    double m_mean = 0;
+    double m_sumSquares = 0;
+    QuantileSketch m_sketch;
+  };
+
+  // Exponentially weighted mean and variance. A span of N values gives the
+  // same centre of mass as a simple average over N values.
+  class Ewma
+  {
+  public:
+    explicit Ewma(size_t span) : m_alpha(2.0 / (double(span) + 1)) {}
+
+    void Add(double x)
+    {
+      if(std::isnan(x))
+	return;
+      if(!m_bStarted){
+	m_mean = x;
+	m_bStarted = true;
+	return;
+      }
+      double delta = x - m_mean;
+      double increment = m_alpha * delta;
+      m_mean += increment;
+      m_variance = (1 - m_alpha) * (m_variance + delta * increment);
+    }
+
+    double Mean() const { return m_bStarted ? m_mean : NAN; }
+    double Variance() const { return m_bStarted ? m_variance : NAN; }
+
+  private:
+    double m_alpha;
+    bool m_bStarted = false;
+    double m_mean = 0;
+    double m_variance = 0;
+  };
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// AGGREGATOR OVER ALL CHANNELS AND WINDOWS
+  //////////////////////////////////////////////////////////////////////////
+
+  // Receives one value per channel for every predicted observation and
+  // prints snapshots of all statistics. Add() and PrintSnapshot() may be
+  // called from different threads.
+  class StreamAggregator
+  {
+  public:
+    StreamAggregator(const std::vector<std::string>& channelNames, const std::vector<size_t>& windowLengths,
+		     const std::vector<double>& quantiles)
+      : m_channelNames(channelNames), m_quantiles(quantiles)
+    {
+      for(size_t iChannel = 0; iChannel < channelNames.size(); iChannel++){
+	for(size_t length : windowLengths){
+	  m_windows.emplace_back(length);
+	  m_ewmas.emplace_back(length);
+	}
+      }
+      m_numWindows = windowLengths.size();
+    }
+
+    size_t NumChannels() const { return m_channelNames.size(); }
+
+    // pValues holds one value per channel, in the order of the channel names
+    void Add(const float* pValues)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(size_t iChannel = 0; iChannel < m_channelNames.size(); iChannel++){
+	for(size_t iWindow = 0; iWindow < m_numWindows; iWindow++){
+	  m_windows[iChannel * m_numWindows + iWindow].Add(pValues[iChannel]);
+	  m_ewmas[iChannel * m_numWindows + iWindow].Add(pValues[iChannel]);
+	}
+      }
+      m_numObservations++;
+    }
+
+    void PrintHeader(std::ostream& out) const
+    {
+      out << "time,observations,channel,window,count,mean,std,ewma,ewstd";
+      for(double q : m_quantiles)
+	out << ",q" << q;
+      out << "\n";
+    }
+
+    // One line per channel and window, all taken under one lock so that a
+    // snapshot is consistent across channels
+    void PrintSnapshot(std::ostream& out, double elapsedSeconds) const
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(size_t iChannel = 0; iChannel < m_channelNames.size(); iChannel++){
+	for(size_t iWindow = 0; iWindow < m_numWindows; iWindow++){
+	  const SlidingWindow& window = m_windows[iChannel * m_numWindows + iWindow];
+	  const Ewma& ewma = m_ewmas[iChannel * m_numWindows + iWindow];
+	  out << std::fixed << std::setprecision(3) << elapsedSeconds << std::defaultfloat << std::setprecision(6)
+	      << "," << m_numObservations << "," << m_channelNames[iChannel] << "," << window.Length()
+	      << "," << window.Count() << "," << window.Mean() << "," << std::sqrt(window.Variance())
+	      << "," << ewma.Mean() << "," << std::sqrt(ewma.Variance());
+	  for(double q : m_quantiles)
+	    out << "," << window.Quantile(q);
+	  out << "\n";
+	}
+      }
+      out.flush();
+    }
+
+  private:
+    std::vector<std::string> m_channelNames;
+    std::vector<double> m_quantiles;
+    size_t m_numWindows = 0;
+    std::vector<SlidingWindow> m_windows; // channel-major
+    std::vector<Ewma> m_ewmas;
+    size_t m_numObservations = 0;
+    mutable std::mutex m_mutex;
+  };
+}
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include "SIMCAQP.h"
+#include "../Common/SQExampleHelpers.h"
+#include "ScoreIndex.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// COPY A SQ_VectorData INTO CONTIGUOUS MEMORY
+//////////////////////////////////////////////////////////////////////////
+
+// Copies the values, row-major, and the row names of a SQ_VectorData
+void CopyVectorData(SQ_VectorData hVectorData, std::vector<float>& values, std::vector<std::string>& rowNames,
+		    int& numRows, int& numColumns)
+{
+  char szBuffer[256];
+
+  SQ_FloatMatrix hMatrix = NULL;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  SQ_GetNumRowsInFloatMatrix(hMatrix, &numRows);
+  SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+  values.resize(size_t(numRows) * size_t(numColumns));
+  float fValue;
+  for(int iRow=1;iRow<=numRows;iRow++){
+    for(int iCol=1;iCol<=numColumns;iCol++){
+      SQ_GetDataFromFloatMatrix(hMatrix, iRow, iCol, &fValue);
+      values[size_t(iRow - 1) * size_t(numColumns) + size_t(iCol - 1)] = fValue;
+    }
+  }
+  SQ_ClearFloatMatrix(&hMatrix);
+
+  SQ_StringVector hRowNames = NULL;
+  SQ_GetRowNames(hVectorData, &hRowNames);
+  for(int iRow=1;iRow<=numRows;iRow++){
+    SQ_GetStringFromVector(hRowNames, iRow, szBuffer, sizeof(szBuffer));
+    rowNames.push_back(szBuffer);
+  }
+  SQ_ClearStringVector(&hRowNames);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=5)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file\n"
+	       <<"and 4) the number of nearest training observations to find for each row\n";
+      return -1;
+    }
+
+  int numNeighbours = std::atoi(argv[4]);
+  if(numNeighbours<1)
+    {
+      std::cout<<"\nThe number of neighbours must be a positive integer\n";
+      return -1;
+    }
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cout << "Could not read any observation from " << argv[3] << std::endl;
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// BUILD THE INDEX OVER THE TRAINING SCORES
+  ////////////////////////////////////////////////////////////////////////
+
+  // Training scores of all observations and components, as in
+  // HandlingModels_GettingScores.cpp, with the observation names
+  SQ_VectorData hTrainingScores = NULL;
+  SQ_GetT(hModel, NULL, &hTrainingScores);
+  std::vector<float> trainingScores;
+  std::vector<std::string> trainingNames;
+  int numTrainingObservations, numComponents;
+  CopyVectorData(hTrainingScores, trainingScores, trainingNames, numTrainingObservations, numComponents);
+  SQ_ClearVectorData(&hTrainingScores);
+
+  auto buildStart = std::chrono::steady_clock::now();
+  ScoreIndex index(trainingScores, size_t(numTrainingObservations), size_t(numComponents),
+		   std::move(trainingNames));
+  std::chrono::duration<double, std::micro> buildTime = std::chrono::steady_clock::now() - buildStart;
+  std::cerr << "Indexed " << numTrainingObservations << " training observations with " << numComponents
+	    << " components (" << (index.UsesTree() ? "k-d tree" : "brute force") << ") in "
+	    << buildTime.count() << " us" << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREDICT THE SCORES OF ALL INPUT ROWS
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), std::string(szBuffer));
+    if(res==inputVariables.end())
+      continue;
+    size_t position = res - inputVariables.begin();
+    for(size_t iObs=0;iObs<rows.size();iObs++){
+      if(position < rows[iObs].size())
+	SQ_SetQuantitativeData(hPreparePrediction, int(iObs + 1), iVar, rows[iObs][position]);
+    }
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  SQ_Prediction hPredictionHandle = NULL;
+  eError = SQ_GetPrediction(hPreparePrediction, &hPredictionHandle);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      SQ_ClearPreparePrediction(&hPreparePrediction);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  // The predicted scores have the same components as the training scores
+  SQ_VectorData hPredictedScores = NULL;
+  SQ_GetTPS(hPredictionHandle, NULL, &hPredictedScores);
+  std::vector<float> queries;
+  std::vector<std::string> queryNames;
+  int numQueries, numQueryComponents;
+  CopyVectorData(hPredictedScores, queries, queryNames, numQueries, numQueryComponents);
+  SQ_ClearVectorData(&hPredictedScores);
+  SQ_ClearPrediction(&hPredictionHandle);
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+
+  if(numQueries == 0)
+    {
+      std::cout << "No scores were predicted for the input rows" << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+  if(numQueryComponents != numComponents)
+    {
+      std::cout << "The predicted scores have " << numQueryComponents << " components, the training scores "
+		<< numComponents << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// FIND THE NEAREST TRAINING OBSERVATIONS OF THE WHOLE BATCH
+  ////////////////////////////////////////////////////////////////////////
+
+  auto searchStart = std::chrono::steady_clock::now();
+  auto neighbours = index.SearchBatch(queries.data(), size_t(numQueries), size_t(numNeighbours));
+  std::chrono::duration<double, std::micro> searchTime = std::chrono::steady_clock::now() - searchStart;
+  std::cerr << "Searched " << numQueries << " rows in " << searchTime.count() / numQueries << " us per row" << std::endl;
+
+  for(int iQuery=0;iQuery<numQueries;iQuery++){
+    std::cout << queryNames[iQuery] << ":";
+    for(auto const& neighbour : neighbours[iQuery])
+      std::cout << " " << index.ObservationName(neighbour.iObservation) << " (" << neighbour.fDistance << ")";
+    std::cout << std::endl;
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  return 0;
+}
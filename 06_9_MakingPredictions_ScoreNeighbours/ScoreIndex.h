@@ -0,0 +1,239 @@
+// Nearest-neighbour search in the score space of a model.
+//
+// The training scores are stored once, column-major (one contiguous array
+// per component), with every component divided by its standard deviation
+// over the training set, so the squared distance between two observations is
+// the Hotelling's T2 distance between them. Queries are answered by brute
+// force, which accumulates the distances of a block of rows one component at
+// a time, a loop the compiler can vectorize across rows, or, for large
+// training sets with few components, by a k-d tree built over the same arrays. With more components a k-d tree has
+// to visit most leaves anyway and is slower than brute force.
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ScoreIndex
+{
+public:
+  struct Neighbour
+  {
+    size_t iObservation; // 0-based row of the training scores
+    float fDistance;
+  };
+
+  // Training sets at least this large, with at most kMaxTreeComponents
+  // components, are searched with the k-d tree
+  static constexpr size_t kMinTreeObservations = 4096;
+  static constexpr size_t kMaxTreeComponents = 8;
+
+  // scores holds numObservations rows of numComponents values, row-major,
+  // as copied from a SQ_FloatMatrix. They are stored column-major.
+  ScoreIndex(const std::vector<float>& scores, size_t numObservations, size_t numComponents,
+	     std::vector<std::string> observationNames)
+    : m_scores(scores.size()), m_numObservations(numObservations), m_numComponents(numComponents),
+      m_observationNames(std::move(observationNames)), m_invStdDev(numComponents, 1.0f)
+  {
+    // Scale every component by the inverse of its standard deviation
+    for(size_t iComp = 0; iComp < m_numComponents; iComp++){
+      double sum = 0, sumSquares = 0;
+      for(size_t iObs = 0; iObs < m_numObservations; iObs++){
+	double x = scores[iObs * m_numComponents + iComp];
+	sum += x;
+	sumSquares += x * x;
+      }
+      double mean = m_numObservations ? sum / double(m_numObservations) : 0;
+      double variance = m_numObservations > 1 ? (sumSquares - mean * sum) / double(m_numObservations - 1) : 0;
+      if(variance > 0)
+	m_invStdDev[iComp] = float(1 / std::sqrt(variance));
+    }
+    for(size_t iComp = 0; iComp < m_numComponents; iComp++){
+      float* pColumn = Column(iComp);
+      for(size_t iObs = 0; iObs < m_numObservations; iObs++)
+	pColumn[iObs] = scores[iObs * m_numComponents + iComp] * m_invStdDev[iComp];
+    }
+
+    if(m_numObservations >= kMinTreeObservations && m_numComponents <= kMaxTreeComponents)
+      BuildTree();
+  }
+
+  bool UsesTree() const { return !m_nodes.empty(); }
+  size_t NumComponents() const { return m_numComponents; }
+  const std::string& ObservationName(size_t iObservation) const { return m_observationNames[iObservation]; }
+
+  // Returns the k nearest training observations of one query, closest first.
+  // pQuery holds the unscaled scores of the query, one per component.
+  std::vector<Neighbour> Search(const float* pQuery, size_t k) const
+  {
+    std::vector<float> query(m_numComponents);
+    for(size_t iComp = 0; iComp < m_numComponents; iComp++)
+      query[iComp] = pQuery[iComp] * m_invStdDev[iComp];
+
+    Heap heap;
+    k = std::min(k, m_numObservations);
+    if(k == 0)
+      return {};
+    if(UsesTree())
+      SearchNode(0, query.data(), k, heap);
+    else
+      SearchRange(0, m_numObservations, query.data(), k, heap);
+
+    std::vector<Neighbour> neighbours(heap.size());
+    for(size_t i = neighbours.size(); i-- > 0; heap.pop())
+      neighbours[i] = Neighbour{ m_order.empty() ? heap.top().second : m_order[heap.top().second],
+				 std::sqrt(heap.top().first) };
+    return neighbours;
+  }
+
+  // Answers a batch of queries, numQueries rows of NumComponents() values
+  std::vector<std::vector<Neighbour>> SearchBatch(const float* pQueries, size_t numQueries, size_t k) const
+  {
+    std::vector<std::vector<Neighbour>> results(numQueries);
+    for(size_t iQuery = 0; iQuery < numQueries; iQuery++)
+      results[iQuery] = Search(pQueries + iQuery * m_numComponents, k);
+    return results;
+  }
+
+private:
+  // Max-heap of (squared distance, row) holding the k best rows so far
+  typedef std::priority_queue<std::pair<float, size_t>> Heap;
+
+  // Rows whose distances are accumulated together by SearchRange()
+  static constexpr size_t kBlockSize = 256;
+
+  float* Column(size_t iComp) { return &m_scores[iComp * m_numObservations]; }
+  const float* Column(size_t iComp) const { return &m_scores[iComp * m_numObservations]; }
+
+  // The inner loop runs over consecutive rows of one component, with no
+  // dependency between rows, so it is vectorized; only the heap updates
+  // afterwards are done row by row
+  void SearchRange(size_t iBegin, size_t iEnd, const float* pQuery, size_t k, Heap& heap) const
+  {
+    float distances[kBlockSize];
+    for(size_t iBlock = iBegin; iBlock < iEnd; iBlock += kBlockSize){
+      size_t numRows = std::min(kBlockSize, iEnd - iBlock);
+      std::fill_n(distances, numRows, 0.0f);
+      for(size_t iComp = 0; iComp < m_numComponents; iComp++){
+	const float* pColumn = Column(iComp) + iBlock;
+	float fQuery = pQuery[iComp];
+	for(size_t i = 0; i < numRows; i++){
+	  float d = pColumn[i] - fQuery;
+	  distances[i] += d * d;
+	}
+      }
+
+      for(size_t i = 0; i < numRows; i++){
+	if(heap.size() < k)
+	  heap.emplace(distances[i], iBlock + i);
+	else if(distances[i] < heap.top().first){
+	  heap.pop();
+	  heap.emplace(distances[i], iBlock + i);
+	}
+      }
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  ////////////// K-D TREE
+  //////////////////////////////////////////////////////////////////////////
+
+  // Nodes cover a contiguous range of rows. The rows are reordered while the
+  // tree is built, so a leaf is searched with the same brute-force loop;
+  // m_order maps reordered rows back to the original observations.
+  struct Node
+  {
+    size_t iBegin, iEnd;
+    size_t iComponent = 0;
+    float fSplit = 0;
+    size_t iLeft = 0, iRight = 0; // 0 for leaves
+  };
+  static constexpr size_t kLeafSize = 32;
+
+  void BuildTree()
+  {
+    m_order.resize(m_numObservations);
+    for(size_t i = 0; i < m_numObservations; i++)
+      m_order[i] = i;
+    m_nodes.push_back(Node{0, m_numObservations});
+    BuildNode(0);
+
+    // Store the rows in tree order
+    std::vector<float> ordered(m_scores.size());
+    for(size_t iComp = 0; iComp < m_numComponents; iComp++){
+      const float* pColumn = Column(iComp);
+      float* pOrdered = &ordered[iComp * m_numObservations];
+      for(size_t i = 0; i < m_numObservations; i++)
+	pOrdered[i] = pColumn[m_order[i]];
+    }
+    m_scores.swap(ordered);
+  }
+
+  void BuildNode(size_t iNode)
+  {
+    size_t iBegin = m_nodes[iNode].iBegin, iEnd = m_nodes[iNode].iEnd;
+    if(iEnd - iBegin <= kLeafSize)
+      return;
+
+    // Split on the component with the largest spread, at the median
+    size_t iComponent = 0;
+    float fBestSpread = -1;
+    for(size_t iComp = 0; iComp < m_numComponents; iComp++){
+      const float* pColumn = Column(iComp);
+      float fMin = INFINITY, fMax = -INFINITY;
+      for(size_t i = iBegin; i < iEnd; i++){
+	float x = pColumn[m_order[i]];
+	fMin = std::min(fMin, x);
+	fMax = std::max(fMax, x);
+      }
+      if(fMax - fMin > fBestSpread){
+	fBestSpread = fMax - fMin;
+	iComponent = iComp;
+      }
+    }
+
+    const float* pSplitColumn = Column(iComponent);
+    size_t iMiddle = iBegin + (iEnd - iBegin) / 2;
+    std::nth_element(m_order.begin() + iBegin, m_order.begin() + iMiddle, m_order.begin() + iEnd,
+		     [&](size_t a, size_t b){ return pSplitColumn[a] < pSplitColumn[b]; });
+
+    m_nodes[iNode].iComponent = iComponent;
+    m_nodes[iNode].fSplit = pSplitColumn[m_order[iMiddle]];
+    size_t iLeft = m_nodes.size();
+    m_nodes.push_back(Node{iBegin, iMiddle});
+    m_nodes.push_back(Node{iMiddle, iEnd});
+    m_nodes[iNode].iLeft = iLeft;
+    m_nodes[iNode].iRight = iLeft + 1;
+    BuildNode(iLeft);
+    BuildNode(iLeft + 1);
+  }
+
+  void SearchNode(size_t iNode, const float* pQuery, size_t k, Heap& heap) const
+  {
+    const Node& node = m_nodes[iNode];
+    if(node.iLeft == 0){
+      SearchRange(node.iBegin, node.iEnd, pQuery, k, heap);
+      return;
+    }
+
+    // Visit the side of the query first; the other side only if the
+    // splitting plane is closer than the k-th neighbour found so far
+    float fOffset = pQuery[node.iComponent] - node.fSplit;
+    size_t iNear = fOffset < 0 ? node.iLeft : node.iRight;
+    size_t iFar = fOffset < 0 ? node.iRight : node.iLeft;
+    SearchNode(iNear, pQuery, k, heap);
+    if(heap.size() < k || fOffset * fOffset < heap.top().first)
+      SearchNode(iFar, pQuery, k, heap);
+  }
+
+  std::vector<float> m_scores; // column-major, scaled
+  size_t m_numObservations;
+  size_t m_numComponents;
+  std::vector<std::string> m_observationNames;
+  std::vector<float> m_invStdDev;
+  std::vector<Node> m_nodes;
+  std::vector<size_t> m_order;
+};
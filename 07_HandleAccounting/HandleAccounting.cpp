@@ -0,0 +1,147 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#define SQ_TRACK_HANDLES
+#include "SQHandleTracking.h" // instead of SIMCAQP.h
+#include "../Common/SQExampleHelpers.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc!=4 && !(argc==5 && strcmp(argv[4],"leak")==0))
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) a model name, 3) the name of an input file\n"
+	       <<"and optionally 4) the word leak to skip clearing some of the handles\n";
+      return -1;
+    }
+  bool bLeak = argc==5;
+
+  std::vector<std::string> inputVariables;
+  std::vector<std::vector<float>> rows;
+  if(!ReadInputFile(argv[3], inputVariables, rows))
+    {
+      std::cout << "Could not read any observation from " << argv[3] << std::endl;
+      return -1;
+    }
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND MODEL
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  SQ_Model hModel = FindFittedModel(hProject, argv[2]);
+  if (hModel == NULL)
+    {
+      std::cout << "Could not find a fitted model named " << argv[2] << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// PREPARE AND MAKE THE PREDICTION
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_PreparePrediction hPreparePrediction = NULL;
+  SQ_GetPreparePrediction(hModel, &hPreparePrediction);
+
+  SQ_VariableVector hPredictionVariables = NULL;
+  SQ_GetVariablesForPrediction(hPreparePrediction, &hPredictionVariables);
+  int numPredSetVariables;
+  SQ_GetNumVariablesInVector(hPredictionVariables, &numPredSetVariables);
+
+  std::map<std::string, int> DataLookup;
+  SQ_Variable hVariable = NULL;
+  for(int iVar=1;iVar<=numPredSetVariables;iVar++){
+    SQ_GetVariableFromVector(hPredictionVariables, iVar, &hVariable);
+    SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+    DataLookup[szBuffer] = iVar;
+  }
+  SQ_ClearVariableVector(&hPredictionVariables);
+
+  // Only the first row of the input file is predicted
+  const std::vector<float>& fQuantitativeData = rows[0];
+
+  for (auto const& [key, val] : DataLookup){
+    auto res = std::find(inputVariables.begin(), inputVariables.end(), key);
+    if(res!=inputVariables.end() && size_t(res - inputVariables.begin()) < fQuantitativeData.size()){
+      int position = res - inputVariables.begin();
+      SQ_SetQuantitativeData(hPreparePrediction, 1, val, fQuantitativeData[position]);
+    }
+  }
+
+  SQ_Prediction hPredictionHandle = NULL;
+  SQ_GetPrediction(hPreparePrediction, &hPredictionHandle);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RETRIEVE THE PREDICTED Y VALUES
+  ////////////////////////////////////////////////////////////////////////
+
+  int numPredictiveScores;
+  SQ_GetNumberOfPredictiveComponents(hModel, &numPredictiveScores);
+
+  SQ_VectorData hPredictedYs = NULL;
+  SQ_GetYPredPS(hPredictionHandle, numPredictiveScores, SQ_Unscaled_True, SQ_Backtransformed_True, NULL, &hPredictedYs);
+
+  SQ_StringVector hYVariableNames = NULL;
+  SQ_GetColumnNames(hPredictedYs, &hYVariableNames);
+  int numYVariables;
+  SQ_GetNumStringsInVector(hYVariableNames, &numYVariables);
+
+  SQ_FloatMatrix hPredictedYsMatrix = NULL;
+  SQ_GetDataMatrix(hPredictedYs, &hPredictedYsMatrix);
+
+  float fYValue;
+  for(int iYVar=1;iYVar<=numYVariables;iYVar++){
+    SQ_GetDataFromFloatMatrix(hPredictedYsMatrix, 1, iYVar, &fYValue);
+    SQ_GetStringFromVector(hYVariableNames, iYVar, szBuffer, sizeof(szBuffer));
+    std::cout << szBuffer << ": " << fYValue << std::endl;
+  }
+
+  // Handles that are alive while the prediction is being used
+  SQTrack_Report(std::cout);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLEAR HANDLES
+  ////////////////////////////////////////////////////////////////////////
+
+  if(!bLeak){
+    SQ_ClearFloatMatrix(&hPredictedYsMatrix);
+    SQ_ClearStringVector(&hYVariableNames);
+  }
+  SQ_ClearVectorData(&hPredictedYs);
+  SQ_ClearPrediction(&hPredictionHandle);
+  SQ_ClearPreparePrediction(&hPreparePrediction);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// CLOSE MODEL AND PROJECT
+  ////////////////////////////////////////////////////////////////////////
+
+  eError = SQ_CloseProject(&hProject);
+  hProject = NULL;
+
+  // Anything still alive here has leaked and is reported again at exit
+  std::cout << "Handles alive after closing the project: " << SQTrack_NumLiveHandles() << std::endl;
+
+  return 0;
+}
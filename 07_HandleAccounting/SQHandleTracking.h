@@ -0,0 +1,393 @@
+// Optional accounting of SIMCA-Q handles.
+//
+// Include this header instead of SIMCAQP.h. When SQ_TRACK_HANDLES is defined
+// (before the include, or on the compiler command line), every SQ_Get*/SQ_Init*
+// call that hands out a handle the caller must clear, and every matching
+// SQ_Clear* call, is routed through a wrapper that records the handle, its
+// type, the file and line of the call and an estimate of the memory it holds.
+// Without SQ_TRACK_HANDLES the header only includes SIMCAQP.h and the calls
+// go straight to SIMCA-Q.
+//
+// SQTrack_Report() prints the live handles at any time. A report is also
+// printed at exit if any handle is still alive. If the environment variable
+// SQ_TRACK_FAIL_ON_LEAK is set, the program then exits with status 1, which
+// lets a test run fail on leaks.
+#pragma once
+#include <iostream>
+#include "SIMCAQP.h"
+
+#ifndef SQ_TRACK_HANDLES
+
+inline void SQTrack_Report(std::ostream& = std::cerr) {}
+inline size_t SQTrack_NumLiveHandles() { return 0; }
+
+#else
+
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+////////////////////////////////////////////////////////////////////////
+////////////// REGISTRY OF LIVE HANDLES
+//////////////////////////////////////////////////////////////////////////
+
+enum SQTrack_HandleType
+  {
+    SQTrack_Project,
+    SQTrack_PreparePrediction,
+    SQTrack_Prediction,
+    SQTrack_VectorData,
+    SQTrack_FloatMatrix,
+    SQTrack_StringVector,
+    SQTrack_VariableVector,
+    SQTrack_IntVector,
+    SQTrack_NumTypes
+  };
+
+inline const char* SQTrack_TypeName(int type)
+{
+  static const char* names[SQTrack_NumTypes] =
+    { "SQ_Project", "SQ_PreparePrediction", "SQ_Prediction", "SQ_VectorData",
+      "SQ_FloatMatrix", "SQ_StringVector", "SQ_VariableVector", "SQ_IntVector" };
+  return names[type];
+}
+
+struct SQTrack_Allocation
+{
+  int type;
+  const char* szFile;
+  int line;
+  size_t bytes;
+};
+
+class SQTrack_Registry
+{
+public:
+  static SQTrack_Registry& Instance()
+  {
+    static SQTrack_Registry registry;
+    return registry;
+  }
+
+  void Add(const void* handle, int type, const char* szFile, int line, size_t bytes)
+  {
+    if(handle == NULL)
+      return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live[handle] = SQTrack_Allocation{type, szFile, line, bytes};
+  }
+
+  void Remove(const void* handle)
+  {
+    if(handle == NULL)
+      return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_live.erase(handle);
+  }
+
+  size_t NumLive()
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_live.size();
+  }
+
+  // Live count and bytes per handle type, followed by every call site that
+  // still owns live handles
+  void Report(std::ostream& out)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t counts[SQTrack_NumTypes] = {};
+    size_t bytes[SQTrack_NumTypes] = {};
+    std::map<std::pair<std::string,int>, std::pair<int,size_t>> sites; // (file, line) -> (type, count)
+    for(const auto& [handle, allocation] : m_live){
+      counts[allocation.type]++;
+      bytes[allocation.type] += allocation.bytes;
+      auto& site = sites[std::make_pair(std::string(allocation.szFile), allocation.line)];
+      site.first = allocation.type;
+      site.second++;
+    }
+
+    out << "SIMCA-Q handles alive: " << m_live.size() << std::endl;
+    for(int type = 0; type < SQTrack_NumTypes; type++){
+      if(counts[type])
+      {
+	out << "  " << SQTrack_TypeName(type) << ": " << counts[type] << " handles";
+	if(bytes[type])
+	  out << ", ~" << bytes[type] << " bytes";
+	out << std::endl;
+      }
+    }
+    for(const auto& [site, allocations] : sites){
+      out << "  " << allocations.second << " x " << SQTrack_TypeName(allocations.first)
+	  << " allocated at " << site.first << ":" << site.second << std::endl;
+    }
+  }
+
+private:
+  SQTrack_Registry() {}
+
+  // Runs at exit, after main() has returned
+  ~SQTrack_Registry()
+  {
+    if(m_live.empty())
+      return;
+    Report(std::cerr);
+    if(std::getenv("SQ_TRACK_FAIL_ON_LEAK") != NULL)
+      {
+	std::cerr << "SQ_TRACK_FAIL_ON_LEAK is set: failing because of leaked SIMCA-Q handles" << std::endl;
+	std::_Exit(1);
+      }
+  }
+
+  std::mutex m_mutex;
+  std::unordered_map<const void*, SQTrack_Allocation> m_live;
+};
+
+inline void SQTrack_Report(std::ostream& out = std::cerr) { SQTrack_Registry::Instance().Report(out); }
+inline size_t SQTrack_NumLiveHandles() { return SQTrack_Registry::Instance().NumLive(); }
+
+////////////////////////////////////////////////////////////////////////
+////////////// MEMORY ESTIMATES
+//////////////////////////////////////////////////////////////////////////
+
+// The estimates only count the payload: 4 bytes per matrix element and the
+// characters of every string. SIMCA-Q's own bookkeeping is not included.
+inline size_t SQTrack_FloatMatrixBytes(SQ_FloatMatrix hMatrix)
+{
+  int numRows = 0, numColumns = 0;
+  SQ_GetNumRowsInFloatMatrix(hMatrix, &numRows);
+  SQ_GetNumColumnsInFloatMatrix(hMatrix, &numColumns);
+  return (size_t)numRows * numColumns * sizeof(float);
+}
+
+inline size_t SQTrack_StringVectorBytes(SQ_StringVector hStrings)
+{
+  char szBuffer[256];
+  int numStrings = 0;
+  size_t bytes = 0;
+  SQ_GetNumStringsInVector(hStrings, &numStrings);
+  for(int i=1;i<=numStrings;i++){
+    SQ_GetStringFromVector(hStrings, i, szBuffer, sizeof(szBuffer));
+    bytes += std::char_traits<char>::length(szBuffer) + 1;
+  }
+  return bytes;
+}
+
+// SQ_VectorData handles are recorded without an estimate: SIMCA-Q only
+// exposes their size through SQ_GetDataMatrix(), which copies the data.
+// Their payload shows up in the SQ_FloatMatrix the caller retrieves instead.
+
+////////////////////////////////////////////////////////////////////////
+////////////// WRAPPERS
+//////////////////////////////////////////////////////////////////////////
+
+#define SQTRACK_ADD(handle, type, bytes)				\
+  if(eError == SQ_E_OK)							\
+    SQTrack_Registry::Instance().Add(handle, type, szFile, line, bytes)
+
+inline SQ_ErrorCode SQTrack_OpenProject(const char* szFile, int line, const char* szUSPFile, const char* szPassword, SQ_Project* pProject)
+{
+  SQ_ErrorCode eError = SQ_OpenProject(szUSPFile, szPassword, pProject);
+  SQTRACK_ADD(*pProject, SQTrack_Project, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_CloseProject(SQ_Project* pProject)
+{
+  SQTrack_Registry::Instance().Remove(*pProject);
+  return SQ_CloseProject(pProject);
+}
+
+inline SQ_ErrorCode SQTrack_GetPreparePrediction(const char* szFile, int line, SQ_Model hModel, SQ_PreparePrediction* pPreparePrediction)
+{
+  SQ_ErrorCode eError = SQ_GetPreparePrediction(hModel, pPreparePrediction);
+  SQTRACK_ADD(*pPreparePrediction, SQTrack_PreparePrediction, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearPreparePrediction(SQ_PreparePrediction* pPreparePrediction)
+{
+  SQTrack_Registry::Instance().Remove(*pPreparePrediction);
+  return SQ_ClearPreparePrediction(pPreparePrediction);
+}
+
+inline SQ_ErrorCode SQTrack_GetPrediction(const char* szFile, int line, SQ_PreparePrediction hPreparePrediction, SQ_Prediction* pPrediction)
+{
+  SQ_ErrorCode eError = SQ_GetPrediction(hPreparePrediction, pPrediction);
+  SQTRACK_ADD(*pPrediction, SQTrack_Prediction, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearPrediction(SQ_Prediction* pPrediction)
+{
+  SQTrack_Registry::Instance().Remove(*pPrediction);
+  return SQ_ClearPrediction(pPrediction);
+}
+
+inline SQ_ErrorCode SQTrack_GetT(const char* szFile, int line, SQ_Model hModel, SQ_IntVector* pComponents, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetT(hModel, pComponents, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetP(const char* szFile, int line, SQ_Model hModel, SQ_IntVector* pComponents, SQ_ReconstructState eReconstruct, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetP(hModel, pComponents, eReconstruct, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetQ2Cum(const char* szFile, int line, SQ_Model hModel, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetQ2Cum(hModel, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetR2XCum(const char* szFile, int line, SQ_Model hModel, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetR2XCum(hModel, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetTPS(const char* szFile, int line, SQ_Prediction hPrediction, SQ_IntVector* pComponents, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetTPS(hPrediction, pComponents, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetYPredPS(const char* szFile, int line, SQ_Prediction hPrediction, int iComponent, SQ_UnscaledState eUnscaled,
+				       SQ_BacktransformedState eBacktransformed, SQ_IntVector* pColumns, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetYPredPS(hPrediction, iComponent, eUnscaled, eBacktransformed, pColumns, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetDataSetObservations(const char* szFile, int line, SQ_Dataset hDataset, SQ_IntVector* pObservations, SQ_VectorData* pVectorData)
+{
+  SQ_ErrorCode eError = SQ_GetDataSetObservations(hDataset, pObservations, pVectorData);
+  SQTRACK_ADD(*pVectorData, SQTrack_VectorData, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearVectorData(SQ_VectorData* pVectorData)
+{
+  SQTrack_Registry::Instance().Remove(*pVectorData);
+  return SQ_ClearVectorData(pVectorData);
+}
+
+inline SQ_ErrorCode SQTrack_GetDataMatrix(const char* szFile, int line, SQ_VectorData hVectorData, SQ_FloatMatrix* pMatrix)
+{
+  SQ_ErrorCode eError = SQ_GetDataMatrix(hVectorData, pMatrix);
+  SQTRACK_ADD(*pMatrix, SQTrack_FloatMatrix, SQTrack_FloatMatrixBytes(*pMatrix));
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearFloatMatrix(SQ_FloatMatrix* pMatrix)
+{
+  SQTrack_Registry::Instance().Remove(*pMatrix);
+  return SQ_ClearFloatMatrix(pMatrix);
+}
+
+inline SQ_ErrorCode SQTrack_GetRowNames(const char* szFile, int line, SQ_VectorData hVectorData, SQ_StringVector* pStrings)
+{
+  SQ_ErrorCode eError = SQ_GetRowNames(hVectorData, pStrings);
+  SQTRACK_ADD(*pStrings, SQTrack_StringVector, SQTrack_StringVectorBytes(*pStrings));
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetColumnNames(const char* szFile, int line, SQ_VectorData hVectorData, SQ_StringVector* pStrings)
+{
+  SQ_ErrorCode eError = SQ_GetColumnNames(hVectorData, pStrings);
+  SQTRACK_ADD(*pStrings, SQTrack_StringVector, SQTrack_StringVectorBytes(*pStrings));
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_GetDataSetObservationNames(const char* szFile, int line, SQ_Dataset hDataset, int iObsID, SQ_StringVector* pStrings)
+{
+  SQ_ErrorCode eError = SQ_GetDataSetObservationNames(hDataset, iObsID, pStrings);
+  SQTRACK_ADD(*pStrings, SQTrack_StringVector, SQTrack_StringVectorBytes(*pStrings));
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearStringVector(SQ_StringVector* pStrings)
+{
+  SQTrack_Registry::Instance().Remove(*pStrings);
+  return SQ_ClearStringVector(pStrings);
+}
+
+inline SQ_ErrorCode SQTrack_GetDataSetVariableNames(const char* szFile, int line, SQ_Dataset hDataset, SQ_VariableVector* pVariables)
+{
+  SQ_ErrorCode eError = SQ_GetDataSetVariableNames(hDataset, pVariables);
+  SQTRACK_ADD(*pVariables, SQTrack_VariableVector, 0);
+  return eError;
+}
+
+// The vector returned by SQ_GetVariablesForPrediction() is a new handle like
+// the one from SQ_GetDataSetVariableNames(); it is not owned by the
+// SQ_PreparePrediction and has to be cleared on its own.
+inline SQ_ErrorCode SQTrack_GetVariablesForPrediction(const char* szFile, int line, SQ_PreparePrediction hPreparePrediction, SQ_VariableVector* pVariables)
+{
+  SQ_ErrorCode eError = SQ_GetVariablesForPrediction(hPreparePrediction, pVariables);
+  SQTRACK_ADD(*pVariables, SQTrack_VariableVector, 0);
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearVariableVector(SQ_VariableVector* pVariables)
+{
+  SQTrack_Registry::Instance().Remove(*pVariables);
+  return SQ_ClearVariableVector(pVariables);
+}
+
+inline SQ_ErrorCode SQTrack_InitIntVector(const char* szFile, int line, SQ_IntVector* pIntVector, int iSize)
+{
+  SQ_ErrorCode eError = SQ_InitIntVector(pIntVector, iSize);
+  SQTRACK_ADD(*pIntVector, SQTrack_IntVector, (size_t)iSize * sizeof(int));
+  return eError;
+}
+
+inline SQ_ErrorCode SQTrack_ClearIntVector(SQ_IntVector* pIntVector)
+{
+  SQTrack_Registry::Instance().Remove(*pIntVector);
+  return SQ_ClearIntVector(pIntVector);
+}
+
+#undef SQTRACK_ADD
+
+////////////////////////////////////////////////////////////////////////
+////////////// REDIRECT THE SIMCA-Q CALLS TO THE WRAPPERS
+//////////////////////////////////////////////////////////////////////////
+
+#define SQ_OpenProject(...) SQTrack_OpenProject(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_CloseProject(...) SQTrack_CloseProject(__VA_ARGS__)
+#define SQ_GetPreparePrediction(...) SQTrack_GetPreparePrediction(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearPreparePrediction(...) SQTrack_ClearPreparePrediction(__VA_ARGS__)
+#define SQ_GetPrediction(...) SQTrack_GetPrediction(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearPrediction(...) SQTrack_ClearPrediction(__VA_ARGS__)
+#define SQ_GetT(...) SQTrack_GetT(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetP(...) SQTrack_GetP(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetQ2Cum(...) SQTrack_GetQ2Cum(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetR2XCum(...) SQTrack_GetR2XCum(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetTPS(...) SQTrack_GetTPS(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetYPredPS(...) SQTrack_GetYPredPS(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetDataSetObservations(...) SQTrack_GetDataSetObservations(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearVectorData(...) SQTrack_ClearVectorData(__VA_ARGS__)
+#define SQ_GetDataMatrix(...) SQTrack_GetDataMatrix(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearFloatMatrix(...) SQTrack_ClearFloatMatrix(__VA_ARGS__)
+#define SQ_GetRowNames(...) SQTrack_GetRowNames(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetColumnNames(...) SQTrack_GetColumnNames(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetDataSetObservationNames(...) SQTrack_GetDataSetObservationNames(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearStringVector(...) SQTrack_ClearStringVector(__VA_ARGS__)
+#define SQ_GetDataSetVariableNames(...) SQTrack_GetDataSetVariableNames(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_GetVariablesForPrediction(...) SQTrack_GetVariablesForPrediction(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearVariableVector(...) SQTrack_ClearVariableVector(__VA_ARGS__)
+#define SQ_InitIntVector(...) SQTrack_InitIntVector(__FILE__, __LINE__, __VA_ARGS__)
+#define SQ_ClearIntVector(...) SQTrack_ClearIntVector(__VA_ARGS__)
+
+#endif
@@ -0,0 +1,432 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "SIMCAQM.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// CANDIDATE CONFIGURATIONS
+//////////////////////////////////////////////////////////////////////////
+
+// One point of the search grid, except for the number of components. The
+// components of a candidate are fitted one at a time, so a single fit with
+// up to maxComponents components covers all component counts of the grid.
+struct Candidate
+{
+  std::string variablesLabel; // "all" or a range like "1-500"
+  int iFirstVariable = 0;     // 0 means all variables
+  int iLastVariable = 0;
+  std::string scalingLabel;
+  SQ_ScaleType eScaling = SQ_ScaleUnitVariance;
+};
+
+// Q2(cum) and R2X(cum) of a candidate for 1, 2, ... fitted components
+struct CandidateResult
+{
+  std::vector<float> q2Cum;
+  std::vector<float> r2XCum;
+  std::string status;
+  int BestComponents() const
+  {
+    return int(std::max_element(q2Cum.begin(), q2Cum.end()) - q2Cum.begin()) + 1;
+  }
+};
+
+// Parses a variable range like "1-500"
+bool ParseVariableRange(const std::string& text, Candidate& candidate)
+{
+  size_t dash = text.find('-');
+  if(dash == std::string::npos)
+    return false;
+  candidate.iFirstVariable = std::atoi(text.substr(0, dash).c_str());
+  candidate.iLastVariable = std::atoi(text.substr(dash + 1).c_str());
+  candidate.variablesLabel = text;
+  return candidate.iFirstVariable >= 1 && candidate.iLastVariable >= candidate.iFirstVariable;
+}
+
+// Translates an index list into a SQ_IntVector handle
+SQ_IntVector MakeIntVector(const std::vector<int>& indices)
+{
+  SQ_IntVector hIntVector = NULL;
+  SQ_InitIntVector(&hIntVector, (int)indices.size());
+  for(size_t i = 0; i < indices.size(); i++)
+    SQ_SetDataInIntVector(hIntVector, int(i + 1), indices[i]);
+  return hIntVector;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// SHARED SEARCH STATE FOR EARLY STOPPING
+//////////////////////////////////////////////////////////////////////////
+
+// The candidates are split into fixed batches, in grid order. A candidate is
+// only compared with the best Q2(cum) of the batches before its own, which
+// are all finished by the time it starts. What is pruned therefore only
+// depends on the grid and the batch size, not on the number of workers or
+// on which worker happens to finish first.
+class SearchBoard
+{
+public:
+  SearchBoard(size_t numCandidates, size_t batchSize)
+    : m_batchSize(batchSize),
+      m_numUnfinished((numCandidates + batchSize - 1) / batchSize, batchSize),
+      m_fBatchBestQ2Cum(m_numUnfinished.size(), -1e30f)
+  {
+    if(!m_numUnfinished.empty())
+      m_numUnfinished.back() = numCandidates - (m_numUnfinished.size() - 1) * batchSize;
+  }
+
+  // Waits until all batches before the one of iCandidate are finished and
+  // returns their best Q2(cum). The candidates of those batches were taken
+  // before iCandidate, so the wait always ends.
+  float BestBefore(size_t iCandidate)
+  {
+    size_t iBatch = iCandidate / m_batchSize;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finished.wait(lock, [&](){ return m_numFinishedBatches >= iBatch; });
+    return m_fBestQ2Cum;
+  }
+
+  // Must be called once for every candidate, also if it could not be fitted
+  void Finish(size_t iCandidate, const std::vector<float>& q2Cum)
+  {
+    size_t iBatch = iCandidate / m_batchSize;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(float fQ2Cum : q2Cum)
+      m_fBatchBestQ2Cum[iBatch] = std::max(m_fBatchBestQ2Cum[iBatch], fQ2Cum);
+    m_numUnfinished[iBatch]--;
+    while(m_numFinishedBatches < m_numUnfinished.size() && m_numUnfinished[m_numFinishedBatches] == 0){
+      m_fBestQ2Cum = std::max(m_fBestQ2Cum, m_fBatchBestQ2Cum[m_numFinishedBatches]);
+      m_numFinishedBatches++;
+    }
+    m_finished.notify_all();
+  }
+
+private:
+  size_t m_batchSize;
+  std::vector<size_t> m_numUnfinished;
+  std::vector<float> m_fBatchBestQ2Cum;
+  size_t m_numFinishedBatches = 0;
+  float m_fBestQ2Cum = -1e30f; // of the finished batches
+  std::mutex m_mutex;
+  std::condition_variable m_finished;
+};
+
+// Pruning bound, not a dominance test: it extrapolates the gain of the last
+// component to all remaining ones and compares that optimistic Q2(cum) with
+// fBestQ2Cum. Gains of later components are normally smaller, but not
+// always, so a pruned candidate could in rare cases have done better. One
+// component says nothing about the gain, so it is never enough.
+bool CannotBeatBest(const std::vector<float>& q2Cum, int maxComponents, float fBestQ2Cum)
+{
+  if(q2Cum.size() < 2)
+    return false;
+  float fGain = q2Cum.back() - q2Cum[q2Cum.size() - 2];
+  float fBound = std::min(1.0f, q2Cum.back() + fGain * float(maxComponents - (int)q2Cum.size()));
+  return fBound < fBestQ2Cum;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// FIT ONE CANDIDATE
+//////////////////////////////////////////////////////////////////////////
+
+// Returns the value of the last component of a Q2(cum) or R2X(cum) handle
+float LastComponentValue(SQ_VectorData hVectorData)
+{
+  SQ_FloatMatrix hMatrix = NULL;
+  SQ_GetDataMatrix(hVectorData, &hMatrix);
+  int numComponents;
+  float fValue = 0;
+  SQ_GetNumRowsInFloatMatrix(hMatrix, &numComponents);
+  SQ_GetDataFromFloatMatrix(hMatrix, numComponents, 1, &fValue);
+  SQ_ClearFloatMatrix(&hMatrix);
+  return fValue;
+}
+
+// Builds a PLS model for the candidate from a new workset on the dataset and
+// fits it component by component
+void FitCandidate(SQ_Project hProject, int iDatasetNumber, int numVariables, int iYVariable, int maxComponents,
+		  float fMinGain, const Candidate& candidate, float fBestQ2Cum, CandidateResult& result)
+{
+  char szError[256];
+  SQ_ErrorCode eError;
+
+  // Workset on the dataset, with one Y variable and the variables outside the
+  // candidate's range excluded
+  SQ_Workset hWorkset = NULL;
+  SQ_IntVector hDatasets = MakeIntVector({iDatasetNumber});
+  eError = SQ_GetNewWorkset(hProject, &hDatasets, &hWorkset);
+  SQ_ClearIntVector(&hDatasets);
+  if(eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      result.status = szError;
+      return;
+    }
+
+  SQ_IntVector hYVariables = MakeIntVector({iYVariable});
+  SQ_SetVariablesAsY(hWorkset, &hYVariables);
+  SQ_ClearIntVector(&hYVariables);
+
+  if(candidate.iFirstVariable > 0){
+    std::vector<int> excluded;
+    for(int iVar=1;iVar<=numVariables;iVar++){
+      if(iVar != iYVariable && (iVar < candidate.iFirstVariable || iVar > candidate.iLastVariable))
+	excluded.push_back(iVar);
+    }
+    if(!excluded.empty()){
+      SQ_IntVector hExcluded = MakeIntVector(excluded);
+      SQ_ExcludeVariables(hWorkset, &hExcluded);
+      SQ_ClearIntVector(&hExcluded);
+    }
+  }
+
+  // NULL applies the scaling to all variables of the workset
+  SQ_SetVariableScaling(hWorkset, NULL, candidate.eScaling);
+  SQ_SetModelType(hWorkset, SQ_PLS);
+
+  int iModelNumber;
+  eError = SQ_CreateModel(hWorkset, &iModelNumber);
+  SQ_ClearWorkset(&hWorkset);
+  if(eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      result.status = szError;
+      return;
+    }
+
+  // Fit one more component at a time and stop as soon as the candidate is
+  // no longer worth fitting
+  for(int numComponents=1;numComponents<=maxComponents;numComponents++){
+    SQ_Model hModel = NULL;
+    eError = SQ_FitModel(hProject, iModelNumber, numComponents);
+    if(eError == SQ_E_OK)
+      eError = SQ_GetModel(hProject, iModelNumber, &hModel);
+    if(eError != SQ_E_OK)
+      {
+	SQ_GetErrorDescription(eError, szError, sizeof(szError));
+	result.status = szError;
+	return;
+      }
+
+    SQ_VectorData hQ2Cum = NULL;
+    SQ_VectorData hR2XCum = NULL;
+    SQ_GetQ2Cum(hModel, &hQ2Cum);
+    SQ_GetR2XCum(hModel, &hR2XCum);
+    result.q2Cum.push_back(LastComponentValue(hQ2Cum));
+    result.r2XCum.push_back(LastComponentValue(hR2XCum));
+    SQ_ClearVectorData(&hQ2Cum);
+    SQ_ClearVectorData(&hR2XCum);
+
+    if(numComponents > 1 && result.q2Cum.back() - result.q2Cum[numComponents - 2] < fMinGain)
+      {
+	result.status = "converged";
+	return;
+      }
+    if(numComponents < maxComponents && CannotBeatBest(result.q2Cum, maxComponents, fBestQ2Cum))
+      {
+	result.status = "pruned";
+	return;
+      }
+  }
+  result.status = "max components";
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// WORKER: CANDIDATES ON ITS OWN PROJECT COPY
+//////////////////////////////////////////////////////////////////////////
+
+// Takes the next unfitted candidate from the shared counter and only writes
+// to that candidate's result slot. The copy is closed without saving.
+void FitCandidatesOnCopy(const char* szUSPFile, int iDatasetNumber, int numVariables, int iYVariable,
+			 int maxComponents, float fMinGain, const std::vector<Candidate>& candidates,
+			 std::atomic<size_t>& nextCandidate, SearchBoard& board, std::vector<CandidateResult>& results)
+{
+  SQ_Project hProject = NULL;
+  if(SQ_OpenProject(szUSPFile, NULL, &hProject) != SQ_E_OK)
+    return;
+
+  for(size_t i = nextCandidate++; i < candidates.size(); i = nextCandidate++){
+    float fBestQ2Cum = board.BestBefore(i);
+    FitCandidate(hProject, iDatasetNumber, numVariables, iYVariable, maxComponents, fMinGain,
+		 candidates[i], fBestQ2Cum, results[i]);
+    board.Finish(i, results[i].q2Cum);
+  }
+
+  SQ_CloseProject(&hProject);
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// MAIN FUNCTION
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc,char* argv[])
+{
+  // Check that all input parameters have been passed
+  if(argc<6)
+    {
+      std::cout<<"\nYou need to pass 1) a SIMCA file, 2) the index of a dataset, 3) the index of the Y variable\n"
+	       <<"in that dataset, 4) the maximum number of components, 5) the number of worker threads\n"
+	       <<"and optionally 6) variable ranges to try besides all variables, e.g. 1-500 300-800\n";
+      return -1;
+    }
+
+  int iDatasetIndex = std::atoi(argv[2]);
+  int iYVariable = std::atoi(argv[3]);
+  int maxComponents = std::atoi(argv[4]);
+  int numWorkers = std::atoi(argv[5]);
+  if(iDatasetIndex<1 || iYVariable<1 || maxComponents<1 || numWorkers<1)
+    {
+      std::cout<<"\nThe indices, the number of components and the number of workers must be positive integers\n";
+      return -1;
+    }
+
+  // Minimum improvement of Q2(cum) for one more component to be kept
+  const float fMinGain = 0.01f;
+
+  SQ_ErrorCode eError; // handler for SIMCA-Q errors
+  char szError[256]; // C-string for handling SIMCA-Q error descriptions
+  char szBuffer[256]; // general C-string handle
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// LOAD PROJECT AND DATASET
+  ////////////////////////////////////////////////////////////////////////
+
+  SQ_Project hProject = NULL;
+  const char * szUSPFile = argv[1];
+  const char * szPassword = NULL;
+  eError = SQ_OpenProject(szUSPFile, szPassword, &hProject);
+  if (eError != SQ_E_OK)
+    {
+      SQ_GetErrorDescription(eError, szError, sizeof(szError));
+      std::cout << szError << std::endl;
+      return -1;
+    }
+
+  int iDatasetNumber;
+  SQ_Dataset hDataset = NULL;
+  SQ_GetDatasetNumberFromIndex(hProject, iDatasetIndex, &iDatasetNumber);
+  if (SQ_GetDataset(hProject, iDatasetNumber, &hDataset) != SQ_E_OK)
+    {
+      std::cout << "Could not find a dataset with index " << iDatasetIndex << std::endl;
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+
+  SQ_VariableVector hVariables = NULL;
+  int numVariables;
+  SQ_GetDataSetVariableNames(hDataset, &hVariables);
+  SQ_GetNumVariablesInVector(hVariables, &numVariables);
+  if(iYVariable > numVariables)
+    {
+      std::cout << "The dataset only has " << numVariables << " variables" << std::endl;
+      SQ_ClearVariableVector(&hVariables);
+      SQ_CloseProject(&hProject);
+      return -1;
+    }
+  SQ_Variable hVariable = NULL;
+  SQ_GetVariableFromVector(hVariables, iYVariable, &hVariable);
+  SQ_GetVariableName(hVariable, 1, szBuffer, sizeof(szBuffer));
+  std::string yVariableName = szBuffer;
+  SQ_ClearVariableVector(&hVariables);
+
+  // The workers open their own copies
+  SQ_CloseProject(&hProject);
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// BUILD THE GRID OF CANDIDATES
+  ////////////////////////////////////////////////////////////////////////
+
+  std::vector<Candidate> variableSubsets(1);
+  variableSubsets[0].variablesLabel = "all";
+  for(int iArg=6;iArg<argc;iArg++){
+    Candidate subset;
+    if(!ParseVariableRange(argv[iArg], subset) || subset.iLastVariable > numVariables)
+      {
+	std::cout << "\nInvalid variable range: " << argv[iArg] << "\n";
+	return -1;
+      }
+    variableSubsets.push_back(subset);
+  }
+
+  const std::vector<std::pair<std::string, SQ_ScaleType>> scalings = {
+    {"UV", SQ_ScaleUnitVariance}, {"Pareto", SQ_ScalePareto}, {"Center", SQ_ScaleCenter}};
+
+  std::vector<Candidate> candidates;
+  for(auto const& subset : variableSubsets){
+    for(auto const& [label, eScaling] : scalings){
+      Candidate candidate = subset;
+      candidate.scalingLabel = label;
+      candidate.eScaling = eScaling;
+      candidates.push_back(candidate);
+    }
+  }
+
+  std::cout << "Fitting " << candidates.size() << " candidates with up to " << maxComponents
+	    << " components for " << yVariableName << " on " << numWorkers << " workers" << std::endl;
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// FIT ALL CANDIDATES IN PARALLEL
+  ////////////////////////////////////////////////////////////////////////
+
+  std::vector<CandidateResult> results(candidates.size());
+  std::atomic<size_t> nextCandidate{0};
+  // One batch per variable subset: its scalings are fitted in parallel and
+  // pruned against the best of the subsets before it
+  SearchBoard board(candidates.size(), scalings.size());
+
+  std::vector<std::thread> workers;
+  for(int iWorker=0;iWorker<numWorkers;iWorker++)
+    workers.emplace_back(FitCandidatesOnCopy, szUSPFile, iDatasetNumber, numVariables, iYVariable, maxComponents,
+			 fMinGain, std::cref(candidates), std::ref(nextCandidate), std::ref(board), std::ref(results));
+  for(auto& worker : workers)
+    worker.join();
+
+  ////////////////////////////////////////////////////////////////////////
+  //////////// RANK CANDIDATES
+  ////////////////////////////////////////////////////////////////////////
+
+  // By best Q2(cum), then by R2X(cum) at that number of components, then by
+  // fewer components. Candidates that could not be fitted go last.
+  std::vector<size_t> ranking;
+  for(size_t i = 0; i < candidates.size(); i++)
+    ranking.push_back(i);
+  std::sort(ranking.begin(), ranking.end(), [&](size_t a, size_t b){
+    const CandidateResult& ra = results[a];
+    const CandidateResult& rb = results[b];
+    if(ra.q2Cum.empty() || rb.q2Cum.empty())
+      return !ra.q2Cum.empty() && rb.q2Cum.empty();
+    int ka = ra.BestComponents(), kb = rb.BestComponents();
+    if(ra.q2Cum[ka - 1] != rb.q2Cum[kb - 1])
+      return ra.q2Cum[ka - 1] > rb.q2Cum[kb - 1];
+    if(ra.r2XCum[ka - 1] != rb.r2XCum[kb - 1])
+      return ra.r2XCum[ka - 1] > rb.r2XCum[kb - 1];
+    return ka < kb;
+  });
+
+  std::cout << std::left << std::setw(6) << "Rank" << std::setw(14) << "Variables" << std::setw(8) << "Scaling"
+	    << std::setw(7) << "Comp" << std::setw(10) << "Q2(cum)" << std::setw(10) << "R2X(cum)"
+	    << std::setw(8) << "Fitted" << "Stopped" << std::endl;
+  std::cout << std::fixed << std::setprecision(4);
+  int iRank = 1;
+  for(size_t i : ranking){
+    const CandidateResult& result = results[i];
+    std::cout << std::setw(6) << iRank++ << std::setw(14) << candidates[i].variablesLabel
+	      << std::setw(8) << candidates[i].scalingLabel;
+    if(result.q2Cum.empty()){
+      std::cout << "not fitted: " << (result.status.empty() ? "project could not be opened" : result.status) << std::endl;
+      continue;
+    }
+    int numComponents = result.BestComponents();
+    std::cout << std::setw(7) << numComponents << std::setw(10) << result.q2Cum[numComponents - 1]
+	      << std::setw(10) << result.r2XCum[numComponents - 1] << std::setw(8) << result.q2Cum.size()
+	      << result.status << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,98 @@
+// Quantile sketch with a bounded relative error, shared by the examples that
+// need quantiles of a stream of values without keeping the values.
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////
+////////////// QUANTILE SKETCH
+//////////////////////////////////////////////////////////////////////////
+
+// Counts values in buckets whose bounds grow geometrically by a factor
+// gamma = (1 + accuracy) / (1 - accuracy). Any value in a bucket is within
+// the relative accuracy of the bucket's representative value. Values can
+// be removed again, which is what makes the sketch usable on a sliding
+// window.
+class QuantileSketch
+{
+public:
+  explicit QuantileSketch(double relativeAccuracy = 0.01)
+    : m_gamma((1 + relativeAccuracy) / (1 - relativeAccuracy)),
+      m_invLogGamma(1 / std::log(m_gamma))
+  {}
+
+  void Add(double x) { Change(x, 1); }
+  void Remove(double x) { Change(x, -1); }
+  size_t Count() const { return m_count; }
+
+  double Quantile(double q) const
+  {
+    if(m_count == 0)
+      return NAN;
+    size_t rank = (size_t)(q * double(m_count - 1) + 0.5);
+    size_t seen = 0;
+    // Negative values, from the most negative, i.e. the largest index
+    for(size_t i = m_negative.counts.size(); i-- > 0;){
+      seen += m_negative.counts[i];
+      if(seen > rank)
+	return -Value(m_negative.offset + int(i));
+    }
+    seen += m_zeroCount;
+    if(seen > rank)
+      return 0;
+    for(size_t i = 0; i < m_positive.counts.size(); i++){
+      seen += m_positive.counts[i];
+      if(seen > rank)
+	return Value(m_positive.offset + int(i));
+    }
+    return Value(m_positive.offset + int(m_positive.counts.size()) - 1);
+  }
+
+private:
+  // Values closer to zero than this are counted as zero
+  static constexpr double kMinIndexable = 1e-12;
+
+  // Contiguous counts for the indices offset, offset + 1, ...
+  struct Buckets
+  {
+    std::vector<uint32_t> counts;
+    int offset = 0;
+
+    void Change(int index, int delta)
+    {
+      if(counts.empty())
+	offset = index;
+      if(index < offset){
+	counts.insert(counts.begin(), size_t(offset - index), 0);
+	offset = index;
+      }
+      if(index - offset >= (int)counts.size())
+	counts.resize(size_t(index - offset + 1), 0);
+      counts[size_t(index - offset)] += delta;
+    }
+  };
+
+  void Change(double x, int delta)
+  {
+    if(std::isnan(x))
+      return;
+    m_count += delta;
+    double absX = std::fabs(x);
+    if(absX < kMinIndexable)
+      m_zeroCount += delta;
+    else
+      (x > 0 ? m_positive : m_negative).Change(Index(absX), delta);
+  }
+
+  int Index(double absX) const { return (int)std::ceil(std::log(absX) * m_invLogGamma); }
+  double Value(int index) const { return 2 * std::pow(m_gamma, index) / (m_gamma + 1); }
+
+  double m_gamma;
+  double m_invLogGamma;
+  Buckets m_positive;
+  Buckets m_negative;
+  size_t m_zeroCount = 0;
+  size_t m_count = 0;
+};
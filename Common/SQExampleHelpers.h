@@ -0,0 +1,125 @@
+// Small helpers shared by several examples of this guide: finding a fitted
+// model by name, reading input files with the layout of sampleSpectrum.csv
+// and dropping rows that are too short for a variable binding.
+#pragma once
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "SIMCAQP.h"
+
+////////////////////////////////////////////////////////////////////////
+////////////// FIND A MODEL BY NAME
+//////////////////////////////////////////////////////////////////////////
+
+// Returns the model named szModelName, or NULL if the project has no such
+// model or it is not fitted. Its number is stored in *pModelNumber if given.
+inline SQ_Model FindFittedModel(SQ_Project hProject, const char* szModelName, int* pModelNumber = NULL)
+{
+  char szBuffer[256];
+  int numModels;
+  SQ_GetNumberOfModels(hProject, &numModels);
+  for(int iModelIndex=1;iModelIndex<=numModels;iModelIndex++){
+    int modelNumber;
+    SQ_Model hModel = NULL;
+    SQ_GetModelNumberFromIndex(hProject, iModelIndex, &modelNumber);
+    if(SQ_GetModel(hProject, modelNumber, &hModel) != SQ_E_OK)
+      continue;
+    SQ_GetModelName(hModel, szBuffer, sizeof(szBuffer));
+    if(strcmp(szBuffer, szModelName) != 0)
+      continue;
+
+    SQ_Bool bIsFitted;
+    if(SQ_IsModelFitted(hModel, &bIsFitted) != SQ_E_OK || bIsFitted != SQ_True)
+      return NULL;
+    if(pModelNumber)
+      *pModelNumber = modelNumber;
+    return hModel;
+  }
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// READ INPUT DATA
+//////////////////////////////////////////////////////////////////////////
+
+// Splits one comma separated line into values. Returns false if a field
+// is not a number.
+inline bool ParseRow(const std::string& line, std::vector<float>& values)
+{
+  values.clear();
+  std::stringstream s(line);
+  std::string word;
+  while (std::getline(s, word, ',')) {
+    try{
+      values.push_back(std::stof(word));
+    }
+    catch(const std::exception&){
+      return false;
+    }
+  }
+  return true;
+}
+
+// Same layout as sampleSpectrum.csv: a first row with the variable names
+// followed by one or more rows of values (one observation per row). Rows
+// with a field that is not a number are reported and skipped.
+inline bool ReadInputFile(const std::string& fileName, std::vector<std::string>& inputVariables,
+			  std::vector<std::vector<float>>& rows)
+{
+  std::ifstream file(fileName);
+  std::string line, word;
+  if(!std::getline(file, line))
+    return false;
+  std::stringstream header(line);
+  while (std::getline(header, word, ',')) {
+    inputVariables.push_back(word);
+  }
+  int iLine = 1;
+  std::vector<float> row;
+  while(std::getline(file, line)){
+    iLine++;
+    if(line.empty() || line == "\r")
+      continue;
+    if(!ParseRow(line, row)){
+      std::cerr << fileName << ", line " << iLine << ": skipped, a value is not a number" << std::endl;
+      continue;
+    }
+    rows.push_back(row);
+  }
+  return !rows.empty();
+}
+
+////////////////////////////////////////////////////////////////////////
+////////////// ROWS THAT ARE TOO SHORT FOR A BINDING
+//////////////////////////////////////////////////////////////////////////
+
+// Number of values a row must have for every variable of a binding, i.e. one
+// past the last bound input column. A binding is a list of (SIMCA-Q variable,
+// input column) pairs.
+template<typename Binding>
+size_t RequiredValues(const Binding& binding)
+{
+  size_t numRequiredValues = 0;
+  for(auto const& [iVar, position] : binding)
+    numRequiredValues = std::max(numRequiredValues, size_t(position) + 1);
+  return numRequiredValues;
+}
+
+// Examples that predict row after row with the same SQ_PreparePrediction
+// handle overwrite the values of the previous row, so a row that is too
+// short for the binding would be predicted with stale values. Removes such
+// rows and reports how many there were. Returns false if no row is left.
+inline bool DropShortRows(std::vector<std::vector<float>>& rows, size_t numRequiredValues)
+{
+  size_t numRows = rows.size();
+  rows.erase(std::remove_if(rows.begin(), rows.end(),
+			    [&](const std::vector<float>& row){ return row.size() < numRequiredValues; }), rows.end());
+  if(rows.size() < numRows)
+    std::cerr << "Skipped " << numRows - rows.size() << " rows with fewer than " << numRequiredValues << " values" << std::endl;
+  return !rows.empty();
+}